@@ -1,78 +1,124 @@
 // 3DoorTest.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <random>
 
-void GetChoices(
-    std::random_device& rdev,
-    const unsigned int number,
-    int* results )
+#include "door_sim.hpp"
+
+// Check the generator against the published Philox4x32-10 known answers
+// (Random123 kat_vectors) before trusting it with anything.
+bool PhiloxSelfTest()
 {
-    // Choose random numbers between 1 and 3 - these represent the doors
-    // either the "users" choices or the correct results
-    std::default_random_engine engine( rdev() );
-    std::mt19937 gen( rdev() ); //Standard mersenne_twister_engine seeded with rd()
-    std::uniform_int_distribution<> distrib( 1, 3 );
+    const door_sim::Philox4x32 zero = door_sim::philox( { { 0, 0, 0, 0 } }, 0, 0 );
+    const door_sim::Philox4x32 ones = door_sim::philox( { { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff } }, 0xffffffff, 0xffffffff );
+    const door_sim::Philox4x32 pi   = door_sim::philox( { { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 } }, 0xa4093822, 0x299f31d0 );
+
+    return zero.v[ 0 ] == 0x6627e8d5 && zero.v[ 1 ] == 0xe169c58d && zero.v[ 2 ] == 0xbc57ac4c && zero.v[ 3 ] == 0x9b00dbd8
+        && ones.v[ 0 ] == 0x408f276d && ones.v[ 1 ] == 0x41c83b0e && ones.v[ 2 ] == 0xa20bc7c6 && ones.v[ 3 ] == 0x6d5451fd
+        && pi.v[ 0 ]   == 0xd16cfe09 && pi.v[ 1 ]   == 0x94fdcceb && pi.v[ 2 ]   == 0x5001e420 && pi.v[ 3 ]   == 0x24126ea1;
+}
 
-    for( unsigned int i = 0; i < number; ++i )
+// Largest door count in the variant sweep; every k from 0 to doors - 2 is run.
+static const uint32_t SWEEP_DOORS = 5;
+
+// Every trial is addressed by its number, so splitting a run anywhere - including
+// half way through a counter or a block - must give the same totals.
+bool SplitRunSelfTest( const door_sim::Game& game, const uint64_t seed )
+{
+    const uint64_t total = 1000;
+    const door_sim::DoorCounts whole = door_sim::run_game_trials( game, seed, 0, total );
+    for( uint64_t split = 1; split < 70; split += 3 )
     {
-        results[i] = ( distrib( gen ) ) - 1;
+        const door_sim::DoorCounts a = door_sim::run_game_trials( game, seed, 0, split );
+        const door_sim::DoorCounts b = door_sim::run_game_trials( game, seed, split, total - split );
+        if( a.straight_wins + b.straight_wins != whole.straight_wins || a.switch_wins + b.switch_wins != whole.switch_wins )
+        {
+            return false;
+        }
     }
+    return true;
 }
 
-int main( int argc, char* argv[] )
+// Same seed, different thread counts, same answer.
+bool ThreadCountSelfTest( const door_sim::Game& game, const uint64_t seed )
 {
-    // Seed with a real random value, if available
-    std::random_device rdev;
-
-    int count = atoi( argv[1] );
+    const uint64_t total = ( 3 * door_sim::CHUNK_TRIALS ) + 12345;
+    const door_sim::DoorCounts one = door_sim::run_parallel( game, seed, total, 1 );
+    for( unsigned threads = 2; threads <= 4; ++threads )
+    {
+        const door_sim::DoorCounts many = door_sim::run_parallel( game, seed, total, threads );
+        if( many.straight_wins != one.straight_wins || many.switch_wins != one.switch_wins )
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-    std::cout << "Running scenarios with " << count << " iterations:\n";
+int main( int argc, char* argv[] )
+{
+    if( argc < 2 )
+    {
+        std::cout << "usage: 3DoorTest <iterations> [seed] [threads]\n";
+        return 1;
+    }
 
-    // Chose the "users" door
-    int* choice = new int[ count ];
-    GetChoices( rdev, count, choice );
+    // No arrays any more, so billions of iterations need no more memory than ten.
+    const uint64_t count = strtoull( argv[ 1 ], nullptr, 10 );
 
-    // Chose the "prize" door
-    int* prize = new int[ count ];
-    GetChoices( rdev, count, prize );
+    // Seed with a real random value, if available, unless asked to replay a seed.
+    // The results for a seed don't depend on the thread count.
+    std::random_device rdev;
+    const uint64_t seed = ( argc > 2 ) ? strtoull( argv[ 2 ], nullptr, 0 )
+                                       : ( static_cast<uint64_t>( rdev() ) << 32 ) | rdev();
+    const unsigned threads = ( argc > 3 ) ? static_cast<unsigned>( atoi( argv[ 3 ] ) ) : 0;
 
-    int straight_wins = 0;
-    int switch_wins = 0;
-    for( int i = 0; i < count; ++i )
+    const door_sim::Game classic = { 3, 1 };
+    const door_sim::Game general = { 7, 3 };
+    if( !PhiloxSelfTest() || !SplitRunSelfTest( classic, seed ) || !SplitRunSelfTest( general, seed )
+        || !ThreadCountSelfTest( classic, seed ) || !ThreadCountSelfTest( general, seed ) )
     {
-        // Calculate win% when user does not change doors.
-        // One case:
-        // The user picks the winning door.
-        if( choice[ i ] == prize[ i ] )
-        {
-            ++straight_wins;
-        }
-
-        // Calculate win% when user does change doors.
-        // Two cases:
-        // The user picks a losing door and must switch to the winner
-        // because the game host has already eliminated the other loser, or
-        // the user picks the winning door and must switch to a loser.
-        // Just count the first case.
-        // Clearly the percent chance is (1 - win%) from above, since we're
-        // literally counting the opposite case.
-        if( choice[ i ] != prize[ i ] )
-        {
-            ++switch_wins;
-        }
+        std::cout << "Random number generator self test failed\n";
+        return 1;
     }
 
-    float straight_win_pct = ( static_cast< float >( straight_wins ) / static_cast< float >( count ) ) * 100.0f;
+    std::cout << "Running scenarios with " << count << " iterations (seed 0x" << std::hex << seed << std::dec << "):\n";
+
+    const auto start = std::chrono::steady_clock::now();
+    const door_sim::DoorCounts counts = door_sim::run_parallel( classic, seed, count, threads );
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    const double straight_win_pct = ( static_cast<double>( counts.straight_wins ) / static_cast<double>( count ) ) * 100.0;
     std::cout << "Win percent no change: " << straight_win_pct << "\n";
 
-    float switch_win_pct = ( static_cast< float >( switch_wins ) / static_cast< float >( count ) ) * 100.0f;
+    const double switch_win_pct = ( static_cast<double>( counts.switch_wins ) / static_cast<double>( count ) ) * 100.0;
     std::cout << "Win percent w/ change: " << switch_win_pct << "\n";
 
-    std::cout << "Total win percentage: " << ( straight_win_pct + switch_win_pct ) << std::endl;
+    std::cout << "Total win percentage: " << ( straight_win_pct + switch_win_pct ) << "\n";
+
+    std::cout << "Time: " << elapsed.count() << " s, "
+              << ( static_cast<double>( count ) / elapsed.count() / 1e6 ) << " M trials/s\n";
+
+    // The rest of the family: N doors, host opens k.  With k < N - 2 switching no
+    // longer always wins when staying loses, so the two columns stop adding to 100.
+    std::cout << "\nDoors Opened   No change (exact)    W/ change (exact)\n";
+    for( uint32_t doors = 3; doors <= SWEEP_DOORS; ++doors )
+    {
+        for( uint32_t opened = 0; opened + 2 <= doors; ++opened )
+        {
+            const door_sim::Game game = { doors, opened };
+            const door_sim::DoorCounts result = door_sim::run_parallel( game, seed, count, threads );
 
-    delete[] choice;
-    delete[] prize;
+            printf( "%5u %6u %9.4f (%7.4f) %11.4f (%7.4f)\n", doors, opened,
+                    100.0 * result.straight_wins / count, 100.0 * door_sim::straight_win_odds( game ),
+                    100.0 * result.switch_wins / count, 100.0 * door_sim::switch_win_odds( game ) );
+        }
+    }
+    std::cout << std::flush;
 }
 
 // Run program: Ctrl + F5 or Debug > Start Without Debugging menu
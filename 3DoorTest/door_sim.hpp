@@ -0,0 +1,325 @@
+#pragma once
+// Streaming Monty Hall simulation on a counter-based random number generator.
+//
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3") turns a
+// 128-bit counter and a 64-bit key into four random 32-bit values.  There is no state
+// to carry from one call to the next: trial t's random numbers depend only on the seed
+// and t.  So trials can be generated in any order, in blocks, without storing them, and
+// memory use is the same for a thousand trials or a trillion.
+//
+// Trials are run in blocks of BLOCK_LANES counters laid out structure-of-arrays.  Every
+// step of the generator and the scoring is a plain loop over the lanes with no
+// branches, so the compiler turns them into SIMD code (SSE2 pmuludq on baseline x86-64,
+// wider with AVX2 or NEON).
+//
+// The same counter trick makes parallel runs reproducible.  Jumping a stream ahead by
+// any number of trials is just adding to the counter, so a run is cut into fixed size
+// chunks, threads take chunks in whatever order they get to them, and the integer
+// win counts are summed.  The totals for a seed are bit-for-bit the same on 1 thread
+// or 64.
+//
+// run_game_trials() covers the general game: N doors, the host opens k of the goat
+// doors, and a switching player picks one of the N - 1 - k doors still closed.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace door_sim
+{
+
+// Philox4x32-10 constants.
+static const uint32_t PHILOX_M0 = 0xD2511F53;
+static const uint32_t PHILOX_M1 = 0xCD9E8D57;
+static const uint32_t PHILOX_W0 = 0x9E3779B9;
+static const uint32_t PHILOX_W1 = 0xBB67AE85;
+static const int      PHILOX_ROUNDS = 10;
+
+// Counters per block.  16 lanes of 32-bit values fill two AVX2 or four SSE registers.
+static const size_t BLOCK_LANES = 16;
+
+struct Philox4x32
+{
+    uint32_t v[ 4 ];
+};
+
+// Scalar Philox4x32-10, one counter at a time.  Reference for the block version.
+inline Philox4x32 philox( Philox4x32 counter, uint32_t key0, uint32_t key1 )
+{
+    for( int round = 0; round < PHILOX_ROUNDS; ++round )
+    {
+        const uint64_t p0 = static_cast<uint64_t>( PHILOX_M0 ) * counter.v[ 0 ];
+        const uint64_t p1 = static_cast<uint64_t>( PHILOX_M1 ) * counter.v[ 2 ];
+
+        counter = { { static_cast<uint32_t>( p1 >> 32 ) ^ counter.v[ 1 ] ^ key0,
+                      static_cast<uint32_t>( p1 ),
+                      static_cast<uint32_t>( p0 >> 32 ) ^ counter.v[ 3 ] ^ key1,
+                      static_cast<uint32_t>( p0 ) } };
+
+        key0 += PHILOX_W0;
+        key1 += PHILOX_W1;
+    }
+    return counter;
+}
+
+// Philox4x32-10 on BLOCK_LANES counters at once, structure-of-arrays: x0[ lane ] is word
+// 0 of lane's counter.  Results replace the counters.
+inline void philox_block( uint32_t* x0, uint32_t* x1, uint32_t* x2, uint32_t* x3, uint32_t key0, uint32_t key1 )
+{
+    for( int round = 0; round < PHILOX_ROUNDS; ++round )
+    {
+        for( size_t lane = 0; lane < BLOCK_LANES; ++lane )
+        {
+            const uint64_t p0 = static_cast<uint64_t>( PHILOX_M0 ) * x0[ lane ];
+            const uint64_t p1 = static_cast<uint64_t>( PHILOX_M1 ) * x2[ lane ];
+
+            const uint32_t y0 = static_cast<uint32_t>( p1 >> 32 ) ^ x1[ lane ] ^ key0;
+            const uint32_t y2 = static_cast<uint32_t>( p0 >> 32 ) ^ x3[ lane ] ^ key1;
+
+            x0[ lane ] = y0;
+            x1[ lane ] = static_cast<uint32_t>( p1 );
+            x2[ lane ] = y2;
+            x3[ lane ] = static_cast<uint32_t>( p0 );
+        }
+
+        key0 += PHILOX_W0;
+        key1 += PHILOX_W1;
+    }
+}
+
+// Map a random 32-bit value onto [ 0, range ) with a multiply instead of a divide.
+// The bias is at most range / 2^32, far below what any simulation here can see.
+inline uint32_t scale( const uint32_t random, const uint32_t range )
+{
+    return static_cast<uint32_t>( ( static_cast<uint64_t>( random ) * range ) >> 32 );
+}
+
+struct DoorCounts
+{
+    uint64_t trials;
+    uint64_t straight_wins;     // wins when the player keeps their door
+    uint64_t switch_wins;       // wins when the player switches
+};
+
+// Run trials [ first_trial, first_trial + count ) of the 3 door game for the given seed.
+// Each counter yields two trials: words 0/1 pick the player's door and the prize door
+// for the first, words 2/3 for the second.
+inline DoorCounts run_three_door_trials( const uint64_t seed, const uint64_t first_trial, const uint64_t count )
+{
+    const uint32_t key0 = static_cast<uint32_t>( seed );
+    const uint32_t key1 = static_cast<uint32_t>( seed >> 32 );
+
+    DoorCounts counts = { count, 0, 0 };
+    uint64_t straight_wins = 0;
+
+    uint32_t x0[ BLOCK_LANES ], x1[ BLOCK_LANES ], x2[ BLOCK_LANES ], x3[ BLOCK_LANES ];
+
+    // Odd first trials start half way through a counter; handle that one on its own.
+    uint64_t trial = first_trial;
+    uint64_t remaining = count;
+    if( ( trial & 1 ) && remaining )
+    {
+        const uint64_t counter = trial >> 1;
+        const Philox4x32 r = philox( { { static_cast<uint32_t>( counter ), static_cast<uint32_t>( counter >> 32 ), 0, 0 } }, key0, key1 );
+        straight_wins += ( scale( r.v[ 2 ], 3 ) == scale( r.v[ 3 ], 3 ) );
+        ++trial;
+        --remaining;
+    }
+
+    const uint64_t trials_per_block = BLOCK_LANES * 2;
+    while( remaining )
+    {
+        const uint64_t counter = trial >> 1;
+        for( size_t lane = 0; lane < BLOCK_LANES; ++lane )
+        {
+            x0[ lane ] = static_cast<uint32_t>( counter + lane );
+            x1[ lane ] = static_cast<uint32_t>( ( counter + lane ) >> 32 );
+            x2[ lane ] = 0;
+            x3[ lane ] = 0;
+        }
+
+        philox_block( x0, x1, x2, x3, key0, key1 );
+
+        // The last block may be partial; lanes past the end score nothing.
+        const uint32_t block_trials = static_cast<uint32_t>( ( remaining < trials_per_block ) ? remaining : trials_per_block );
+        uint32_t block_wins = 0;
+        for( uint32_t lane = 0; lane < BLOCK_LANES; ++lane )
+        {
+            // Doors are 0, 1 and 2.  The player picks one, the prize is behind one.
+            // Calculate win% when user does not change doors.
+            // One case:
+            // The user picks the winning door.
+            const uint32_t first_live  = ( lane * 2 + 0 ) < block_trials;
+            const uint32_t second_live = ( lane * 2 + 1 ) < block_trials;
+            const uint32_t first_win   = scale( x0[ lane ], 3 ) == scale( x1[ lane ], 3 );
+            const uint32_t second_win  = scale( x2[ lane ], 3 ) == scale( x3[ lane ], 3 );
+            block_wins += ( first_live & first_win ) + ( second_live & second_win );
+        }
+
+        straight_wins += block_wins;
+        trial += block_trials;
+        remaining -= block_trials;
+    }
+
+    // Calculate win% when user does change doors.
+    // Two cases:
+    // The user picks a losing door and must switch to the winner
+    // because the game host has already eliminated the other loser, or
+    // the user picks the winning door and must switch to a loser.
+    // Just count the first case.
+    // Clearly the percent chance is (1 - win%) from above, since we're
+    // literally counting the opposite case.
+    counts.straight_wins = straight_wins;
+    counts.switch_wins = count - straight_wins;
+    return counts;
+}
+
+// N doors, k of them opened by the host.  The classic game is { 3, 1 }.
+struct Game
+{
+    uint32_t doors;
+    uint32_t opened;    // 0 .. doors - 2; the host never opens the player's door or the prize
+};
+
+inline bool is_valid( const Game& game )
+{
+    return game.doors >= 2 && game.opened + 2 <= game.doors;
+}
+
+// Exact odds, for checking the simulation.
+inline double straight_win_odds( const Game& game )
+{
+    return 1.0 / game.doors;
+}
+
+inline double switch_win_odds( const Game& game )
+{
+    // Switching wins when the first pick was wrong (N - 1 of N) and the prize is the
+    // door picked out of the N - 1 - k left.
+    return ( static_cast<double>( game.doors - 1 ) / game.doors ) / ( game.doors - 1 - game.opened );
+}
+
+// Trials [ first_trial, first_trial + count ) of the general game.  One counter per
+// trial: word 0 is the player's door, word 1 the prize door and word 2 the door a
+// switching player moves to, out of the ones still closed.
+//
+// Which goats the host shows doesn't matter to the outcome, so it isn't simulated.
+// If the player started on a goat, the prize is always among the closed doors left
+// (the host can't open it), and the switch wins when it lands on that one.  If the
+// player started on the prize, every switch loses.
+//
+// Each game gets its own stream (counter word 3), so two variants with the same seed
+// don't share random numbers.
+inline DoorCounts run_general_trials( const Game& game, const uint64_t seed, const uint64_t first_trial, const uint64_t count )
+{
+    const uint32_t key0 = static_cast<uint32_t>( seed );
+    const uint32_t key1 = static_cast<uint32_t>( seed >> 32 );
+    const uint32_t stream = ( game.doors << 16 ) | game.opened;
+    const uint32_t closed = game.doors - 1 - game.opened;
+
+    DoorCounts counts = { count, 0, 0 };
+    uint32_t x0[ BLOCK_LANES ], x1[ BLOCK_LANES ], x2[ BLOCK_LANES ], x3[ BLOCK_LANES ];
+
+    uint64_t trial = first_trial;
+    uint64_t remaining = count;
+    while( remaining )
+    {
+        for( size_t lane = 0; lane < BLOCK_LANES; ++lane )
+        {
+            x0[ lane ] = static_cast<uint32_t>( trial + lane );
+            x1[ lane ] = static_cast<uint32_t>( ( trial + lane ) >> 32 );
+            x2[ lane ] = 0;
+            x3[ lane ] = stream;
+        }
+
+        philox_block( x0, x1, x2, x3, key0, key1 );
+
+        const uint32_t block_trials = static_cast<uint32_t>( ( remaining < BLOCK_LANES ) ? remaining : BLOCK_LANES );
+        uint32_t straight_wins = 0;
+        uint32_t switch_wins = 0;
+        for( uint32_t lane = 0; lane < BLOCK_LANES; ++lane )
+        {
+            const uint32_t live   = lane < block_trials;
+            const uint32_t choice = scale( x0[ lane ], game.doors );
+            const uint32_t prize  = scale( x1[ lane ], game.doors );
+            const uint32_t pick   = scale( x2[ lane ], closed );
+            straight_wins += live & ( choice == prize );
+            switch_wins   += live & ( choice != prize ) & ( pick == 0 );
+        }
+
+        counts.straight_wins += straight_wins;
+        counts.switch_wins += switch_wins;
+        trial += block_trials;
+        remaining -= block_trials;
+    }
+
+    return counts;
+}
+
+// The classic game has its own faster path (two trials per counter, no switch pick).
+inline DoorCounts run_game_trials( const Game& game, const uint64_t seed, const uint64_t first_trial, const uint64_t count )
+{
+    if( game.doors == 3 && game.opened == 1 )
+    {
+        return run_three_door_trials( seed, first_trial, count );
+    }
+    return run_general_trials( game, seed, first_trial, count );
+}
+
+// Trials per chunk handed to a thread.  Fixed, so the work split doesn't depend on
+// the thread count - not that it would change the totals anyway.
+static const uint64_t CHUNK_TRIALS = 1 << 22;
+
+// Run trials [ 0, count ) on thread_count threads (0 = one per core).
+inline DoorCounts run_parallel( const Game& game, const uint64_t seed, const uint64_t count, unsigned thread_count = 0 )
+{
+    const uint64_t chunks = ( count + CHUNK_TRIALS - 1 ) / CHUNK_TRIALS;
+
+    if( thread_count == 0 )
+    {
+        thread_count = std::max( 1u, std::thread::hardware_concurrency() );
+    }
+    thread_count = static_cast<unsigned>( std::min<uint64_t>( thread_count, std::max<uint64_t>( chunks, 1 ) ) );
+
+    // Threads pull chunks off a shared counter and keep their own totals.
+    std::atomic<uint64_t> next_chunk( 0 );
+    std::vector<DoorCounts> thread_counts( thread_count, DoorCounts{ 0, 0, 0 } );
+
+    auto worker = [ & ]( const unsigned index )
+    {
+        DoorCounts& total = thread_counts[ index ];
+        for( uint64_t chunk = next_chunk++; chunk < chunks; chunk = next_chunk++ )
+        {
+            const uint64_t first = chunk * CHUNK_TRIALS;
+            const DoorCounts part = run_game_trials( game, seed, first, std::min( CHUNK_TRIALS, count - first ) );
+            total.trials += part.trials;
+            total.straight_wins += part.straight_wins;
+            total.switch_wins += part.switch_wins;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for( unsigned index = 1; index < thread_count; ++index )
+    {
+        threads.emplace_back( worker, index );
+    }
+    worker( 0 );
+    for( std::thread& thread : threads )
+    {
+        thread.join();
+    }
+
+    DoorCounts counts = { 0, 0, 0 };
+    for( const DoorCounts& part : thread_counts )
+    {
+        counts.trials += part.trials;
+        counts.straight_wins += part.straight_wins;
+        counts.switch_wins += part.switch_wins;
+    }
+    return counts;
+}
+
+}
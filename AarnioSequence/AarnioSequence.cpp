@@ -1,93 +1,107 @@
 // AarnioSequence.cpp : This file contains the 'main' function. Program execution begins and ends there.
 // Purpose:  Find integral numbers that evenly divide by their reversed selves, e.g., 8712 & 2178
-
+//
+// The search engine is in reversal_search.hpp: integer only, digit arrays that update
+// incrementally, a power-of-ten table and exact % checks.  The old version converted
+// every candidate to a string, called pow() in a loop and compared float divisions.
+//
+// find_reversal_multiples_parallel() goes further: it searches digit by digit from
+// both ends at once, dropping whole subranges, split across threads.
+//
+// Usage: AarnioSequence [last [threads]]   (searches 10 .. last, default 10^18, one thread per core)
+
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
-#include <math.h>
-#include <string>
-
-int get_exponent( const unsigned int value )
-{
-    std::string value_str = std::to_string( value );
-    return static_cast<int>( value_str.length() - 1 );
-}
-
-bool low_number_skip( unsigned int& value )
-{
-    // Numbers that have units digit larger than 2x leading digit should be skipped.
-    // Dividing smaller numbers by bigger numbers gives a 1/whole number result
-    // which is not useful for this search.
-    int exponent = get_exponent( value );
-    int base_value = static_cast<int>( pow( 10, exponent ) );
-    int leading_digit = static_cast< int >( value / base_value );
-
-    int trailing_digit = value % 10;
-
-    return ( leading_digit < trailing_digit * 2 );
-}
-
-int reverse_number( unsigned int number )
-{
-    int reversed_num = 0;
-
-    int exponent_in = get_exponent( number );
-    int exponent_out = 0;
-
-    do
-    {
-        // Find each digit
-        int base = static_cast<int>( pow( 10, exponent_in-- ) );
-        int digit = static_cast< int >( number / base );
-        if( 0 != digit )
-        {
-            // Remove the digit from the starting number
-            number -= static_cast<int>( digit * base );
+#include <vector>
 
-            // Put the digit into the reverse order position
-            digit *= static_cast< int >( pow( 10, exponent_out ) );
+#include "reversal_search.hpp"
 
-            // Add the reversed digit to the output value
-            reversed_num += digit;
-        }
-        ++exponent_out;
-    } while( number );
-
-    return reversed_num;
-}
-
-int main()
+// Straightforward version of the search, used to check the engine on a small range.
+static std::vector<reversal::Match> brute_force_search( const uint64_t first, const uint64_t last )
 {
-    unsigned int value = 1000;
-    while( value < 1000000 )
+    std::vector<reversal::Match> matches;
+    for( uint64_t value = first; value <= last; ++value )
     {
-        // Numbers that end in zero don't count, nor do numbers whose MSD is less than 2x the LSD
-        if( !( value % 10 ) || low_number_skip( value ) )
+        // Numbers that end in zero don't count
+        if( !( value % 10 ) )
         {
-            value++;
             continue;
         }
 
-        // Reverse the number
-        int divisor = reverse_number( value );
-
         // Palindromes don't count
+        const uint64_t divisor = reversal::reverse_number( value );
         if( divisor == value )
         {
-            value++;
             continue;
         }
 
-        // Look for an integer division result
-        float float_result = static_cast<float>( value ) / static_cast<float>( divisor );
-        float   int_result = static_cast<float>( value / divisor );
-        if( float_result == static_cast<float>( int_result ) )
+        if( value % divisor == 0 )
         {
-            // Yippee, integer result, pring it out.
-            std::cout << value << " & " << divisor << " ( =" << int_result << " )\n";
+            matches.push_back( { value, divisor, value / divisor } );
         }
+    }
+    return matches;
+}
 
-        // Move to the next number
-        value++;
+// Compare two result lists by value and reversal.
+static bool same_matches( const std::vector<reversal::Match>& a, const std::vector<reversal::Match>& b )
+{
+    bool same = ( a.size() == b.size() );
+    for( size_t n = 0; same && n < a.size(); ++n )
+    {
+        same = ( a[ n ].value == b[ n ].value ) && ( a[ n ].reversed == b[ n ].reversed );
     }
+    return same;
+}
+
+int main( int argc, char* argv[] )
+{
+    const uint64_t last = ( argc > 1 ) ? std::strtoull( argv[ 1 ], nullptr, 10 ) : reversal::pow10[ 18 ];
+    const unsigned threads = ( argc > 2 ) ? static_cast<unsigned>( std::atoi( argv[ 2 ] ) ) : 0;
+
+    // Check the scanning engine against the brute force search first...
+    static const uint64_t CHECK_LAST = 1000000;
+    std::vector<reversal::Match> expected = brute_force_search( 10, CHECK_LAST );
+    std::vector<reversal::Match> found;
+    reversal::find_reversal_multiples( 10, CHECK_LAST, found );
+    std::cout << "Scan check against brute force up to " << CHECK_LAST << ": "
+              << ( same_matches( expected, found ) ? "ok" : "MISMATCH" ) << "\n";
+
+    // ...and the digit search against the scan, timing both.
+    static const uint64_t SCAN_LAST = 1000000000;
+    expected.clear();
+    auto start = std::chrono::steady_clock::now();
+    reversal::find_reversal_multiples( 10, SCAN_LAST, expected );
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> scan_time = end - start;
+
+    found.clear();
+    start = std::chrono::steady_clock::now();
+    reversal::find_reversal_multiples_parallel( 10, SCAN_LAST, found, threads );
+    end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> digit_time = end - start;
+
+    std::cout << "Digit search check against scan up to " << SCAN_LAST << ": "
+              << ( same_matches( expected, found ) ? "ok" : "MISMATCH" )
+              << " (scan " << scan_time.count() << " s, "
+              << ( static_cast<double>( SCAN_LAST - 9 ) / scan_time.count() / 1e6 ) << " million candidates/s; digit search "
+              << digit_time.count() << " s)\n";
+
+    // Now the real search.
+    found.clear();
+    start = std::chrono::steady_clock::now();
+    reversal::find_reversal_multiples_parallel( 10, last, found, threads );
+    end = std::chrono::steady_clock::now();
+
+    for( const reversal::Match& match : found )
+    {
+        // Yippee, integer result, print it out.
+        std::cout << match.value << " & " << match.reversed << " ( =" << match.multiple << " )\n";
+    }
+
+    std::chrono::duration<double> elapsed = end - start;
+    std::cout << found.size() << " found searching 10 - " << last << " in " << elapsed.count() << " s\n";
 
     std::cout << "Done!\n";
 }
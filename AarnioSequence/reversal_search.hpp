@@ -0,0 +1,365 @@
+#pragma once
+// Integer-only search for numbers that are an exact multiple of their digit reversal,
+// e.g., 8712 = 4 * 2178.
+//
+// Write a candidate as v = prefix * 10 + U, where U is the units digit and L is the
+// leading digit.  The reversal r = U * 10^(n-1) + reverse( prefix ).
+//
+// The search never converts to strings or calls pow():
+//   - prefix is kept as a digit array, and reverse( prefix ) is updated
+//     incrementally as prefix counts up (one table lookup per digit that changes),
+//   - powers of ten come from a table,
+//   - divisibility is checked exactly with %.
+//
+// Most candidates are ruled out by their leading (L) and units (U) digits alone.
+// If v = k * r for k in 2..9 then:
+//   - ( k * L ) % 10 == U, because r's units digit is v's leading digit, and
+//   - k * U <= L < k * ( U + 1 ), from comparing the leading digits of v and k * r.
+// Only a few ( L, U ) pairs pass.  Prefixes whose leading digit has no valid U are
+// skipped a whole block at a time.  The rest only try the U values that pass.
+// This is the exact form of the old "leading digit < 2x the trailing digit" skip.
+//
+// find_reversal_multiples_parallel() pushes the same idea all the way through the
+// number and searches by digits instead of by value.  Pick a digit count n and a
+// multiple k.  Choosing the top j digits of v fixes the bottom j digits of r, and so
+// the bottom j digits of v = k * r.  That in turn fixes the top j digits of r, and
+// the possible range of k * r has to overlap the range of numbers that start with
+// those top j digits of v.  Subranges that fail are dropped whole.  The search is
+// split by ( n, k, leading digit ) into independent tasks run on a pool of threads.
+// The results are merged and sorted at the end.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace reversal
+{
+
+// 10^0 .. 10^19; 10^19 is the largest power of ten in a uint64_t.
+static constexpr size_t max_digits = 20;
+
+constexpr std::array<uint64_t, max_digits> build_pow10()
+{
+    std::array<uint64_t, max_digits> table{};
+    uint64_t value = 1;
+    for( size_t n = 0; n < max_digits; ++n )
+    {
+        table[ n ] = value;
+        value *= 10;
+    }
+    return table;
+}
+
+static constexpr auto pow10 = build_pow10();
+
+// valid_units[ L ] has bit U set if leading digit L and units digit U can belong to a
+// number v = k * reverse( v ) with k >= 2 (see above).
+constexpr std::array<uint16_t, 10> build_valid_units()
+{
+    std::array<uint16_t, 10> valid{};
+    for( uint32_t lead = 1; lead <= 9; ++lead )
+    {
+        for( uint32_t k = 2; k <= 9; ++k )
+        {
+            const uint32_t units = ( k * lead ) % 10;
+            if( units != 0 && k * units <= lead && lead < k * ( units + 1 ) )
+            {
+                valid[ lead ] |= static_cast<uint16_t>( 1u << units );
+            }
+        }
+    }
+    return valid;
+}
+
+static constexpr auto valid_units = build_valid_units();
+
+// Number of decimal digits in value (1 for zero).
+inline size_t digit_count( const uint64_t value )
+{
+    size_t digits = 1;
+    while( digits < max_digits && value >= pow10[ digits ] )
+    {
+        ++digits;
+    }
+    return digits;
+}
+
+// Reverse the digits of value, e.g., 2178 -> 8712.  Trailing zeros are dropped.
+inline uint64_t reverse_number( uint64_t value )
+{
+    uint64_t reversed = 0;
+    while( value )
+    {
+        reversed = ( reversed * 10 ) + ( value % 10 );
+        value /= 10;
+    }
+    return reversed;
+}
+
+struct Match
+{
+    uint64_t value;
+    uint64_t reversed;
+    uint64_t multiple;  // value / reversed
+};
+
+// Find every v in [ first, last ] with v % reverse( v ) == 0, v != reverse( v ),
+// and v not ending in zero.  Matches are appended in increasing order.
+// Returns the number of matches found.
+inline size_t find_reversal_multiples( const uint64_t first, const uint64_t last, std::vector<Match>& matches )
+{
+    // Single digit numbers are palindromes.
+    const uint64_t low = ( first < 10 ) ? 10 : first;
+    if( low > last )
+    {
+        return 0;
+    }
+
+    const size_t start_count = matches.size();
+    const uint64_t last_prefix = last / 10;
+    uint64_t prefix = low / 10;
+
+    // prefix digits, units first, and the reversal of the prefix
+    std::array<uint8_t, max_digits> digits{};
+    size_t   prefix_digits = 0;
+    uint64_t reversed_prefix = 0;
+    uint64_t units_weight = 0;      // 10^(n-1), the weight of U in the reversal
+
+    auto load_prefix = [ & ]( const uint64_t value )
+    {
+        prefix_digits = digit_count( value );
+        units_weight = pow10[ prefix_digits ];
+        reversed_prefix = 0;
+
+        uint64_t rest = value;
+        for( size_t n = 0; n < prefix_digits; ++n )
+        {
+            digits[ n ] = static_cast<uint8_t>( rest % 10 );
+            rest /= 10;
+            reversed_prefix += digits[ n ] * pow10[ prefix_digits - 1 - n ];
+        }
+    };
+
+    load_prefix( prefix );
+    while( prefix <= last_prefix )
+    {
+        const uint8_t lead = digits[ prefix_digits - 1 ];
+        const uint16_t units = valid_units[ lead ];
+
+        if( !units )
+        {
+            // Nothing with this leading digit can match; jump to the next one.
+            const uint64_t next = ( lead + 1 ) * pow10[ prefix_digits - 1 ];
+            if( next <= prefix || next > last_prefix )
+            {
+                break;
+            }
+            prefix = next;
+            load_prefix( prefix );
+            continue;
+        }
+
+        for( uint64_t u = 1; u <= 9; ++u )
+        {
+            if( !( units & ( 1u << u ) ) )
+            {
+                continue;
+            }
+
+            const uint64_t value = ( prefix * 10 ) + u;
+            const uint64_t reversed = ( u * units_weight ) + reversed_prefix;
+            if( value >= low && value <= last && value % reversed == 0 )
+            {
+                matches.push_back( { value, reversed, value / reversed } );
+            }
+        }
+
+        // Count the prefix up by one, carrying through the digit array.
+        if( prefix == last_prefix )
+        {
+            break;
+        }
+        ++prefix;
+
+        size_t pos = 0;
+        while( pos < prefix_digits && digits[ pos ] == 9 )
+        {
+            digits[ pos ] = 0;
+            reversed_prefix -= 9 * pow10[ prefix_digits - 1 - pos ];
+            ++pos;
+        }
+
+        if( pos == prefix_digits )
+        {
+            // 999 -> 1000, one more digit.
+            load_prefix( prefix );
+        }
+        else
+        {
+            ++digits[ pos ];
+            reversed_prefix += pow10[ prefix_digits - 1 - pos ];
+        }
+    }
+
+    return matches.size() - start_count;
+}
+
+namespace detail
+{
+    // One ( digit count, multiple, leading digit ) slice of the digit-by-digit search.
+    struct DigitSearch
+    {
+        uint64_t first;
+        uint64_t last;
+        size_t   digits;        // n, digits in v
+        uint64_t multiple;      // k
+        std::vector<Match>* matches;
+
+        // Reverse the low count digits of value, keeping leading zeros as digits.
+        static uint64_t reverse_digits( uint64_t value, const size_t count )
+        {
+            uint64_t reversed = 0;
+            for( size_t n = 0; n < count; ++n )
+            {
+                reversed = ( reversed * 10 ) + ( value % 10 );
+                value /= 10;
+            }
+            return reversed;
+        }
+
+        // top: the first j digits of v.  top_reversed: those digits reversed (j digits),
+        // which are the last j digits of r.
+        void Search( const uint64_t top, const uint64_t top_reversed, const size_t j ) const
+        {
+            // v = k * r, so the last j digits of v follow from the last j digits of r.
+            const uint64_t bottom = ( multiple * top_reversed ) % pow10[ j ];
+            if( bottom % 10 == 0 )
+            {
+                return; // v would end in zero
+            }
+
+            const size_t rest = digits - j;
+            if( 2 * j >= digits )
+            {
+                // All digits known.  For odd n the middle digit is in both halves.
+                if( 2 * j > digits && ( top % 10 ) != bottom / pow10[ j - 1 ] )
+                {
+                    return;
+                }
+
+                const uint64_t value = ( top * pow10[ rest ] ) + ( bottom % pow10[ rest ] );
+                const uint64_t reversed = reverse_number( value );
+                if( value >= first && value <= last && value % reversed == 0 && value / reversed == multiple )
+                {
+                    matches->push_back( { value, reversed, multiple } );
+                }
+                return;
+            }
+
+            // Range of v: starts with top.  Range of r: starts with reverse( bottom ).
+            const uint64_t value_low  = std::max( top * pow10[ rest ], first );
+            const uint64_t value_high = std::min( ( ( top + 1 ) * pow10[ rest ] ) - 1, last );
+            const uint64_t r_top      = reverse_digits( bottom, j );
+            const uint64_t r_low      = r_top * pow10[ rest ];
+            const uint64_t r_high     = ( ( r_top + 1 ) * pow10[ rest ] ) - 1;
+
+            // Does [ k * r_low, k * r_high ] overlap [ value_low, value_high ]?
+            // Divide rather than multiply so nothing overflows.
+            if( value_low > value_high || r_low > value_high / multiple || r_high < ( value_low + multiple - 1 ) / multiple )
+            {
+                return;
+            }
+
+            for( uint64_t digit = 0; digit <= 9; ++digit )
+            {
+                Search( ( top * 10 ) + digit, top_reversed + ( digit * pow10[ j ] ), j + 1 );
+            }
+        }
+    };
+}
+
+// Same results as find_reversal_multiples(), found digit by digit on thread_count
+// threads (0 = one per core).  Matches are appended sorted by value.
+inline size_t find_reversal_multiples_parallel( const uint64_t first, const uint64_t last, std::vector<Match>& matches, unsigned thread_count = 0 )
+{
+    const uint64_t low = ( first < 10 ) ? 10 : first;
+    if( low > last )
+    {
+        return 0;
+    }
+
+    // A 20 digit uint64_t starts with 1, so k * r >= 2 * 10^19 would overflow;
+    // there are no 20 digit matches.
+    const size_t min_digits = digit_count( low );
+    const size_t max_digits_searched = std::min<size_t>( digit_count( last ), max_digits - 1 );
+
+    struct Task
+    {
+        size_t   digits;
+        uint64_t multiple;
+        uint64_t lead;
+    };
+
+    std::vector<Task> tasks;
+    for( size_t digits = min_digits; digits <= max_digits_searched; ++digits )
+    {
+        for( uint64_t multiple = 2; multiple <= 9; ++multiple )
+        {
+            for( uint64_t lead = 1; lead <= 9; ++lead )
+            {
+                // The units digit filter from the scanning search, per multiple.
+                const uint64_t units = ( multiple * lead ) % 10;
+                if( units != 0 && ( valid_units[ lead ] & ( 1u << units ) ) )
+                {
+                    tasks.push_back( { digits, multiple, lead } );
+                }
+            }
+        }
+    }
+
+    if( thread_count == 0 )
+    {
+        thread_count = std::max( 1u, std::thread::hardware_concurrency() );
+    }
+    thread_count = static_cast<unsigned>( std::min<size_t>( thread_count, std::max<size_t>( tasks.size(), 1 ) ) );
+
+    // Threads pull tasks off a shared counter and keep their own results.
+    std::atomic<size_t> next_task( 0 );
+    std::vector<std::vector<Match>> thread_matches( thread_count );
+
+    auto worker = [ & ]( const unsigned index )
+    {
+        for( size_t task = next_task++; task < tasks.size(); task = next_task++ )
+        {
+            const Task& t = tasks[ task ];
+            const detail::DigitSearch search{ low, last, t.digits, t.multiple, &thread_matches[ index ] };
+            search.Search( t.lead, t.lead, 1 );
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for( unsigned index = 1; index < thread_count; ++index )
+    {
+        threads.emplace_back( worker, index );
+    }
+    worker( 0 );
+    for( std::thread& thread : threads )
+    {
+        thread.join();
+    }
+
+    const size_t start_count = matches.size();
+    for( const std::vector<Match>& found : thread_matches )
+    {
+        matches.insert( matches.end(), found.begin(), found.end() );
+    }
+    std::sort( matches.begin() + start_count, matches.end(),
+               []( const Match& a, const Match& b ) { return a.value < b.value; } );
+
+    return matches.size() - start_count;
+}
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+// CPU stand-in for the CUDA launch in cudasample.cu, for machines without a GPU or nvcc.
+//
+// The kernel there uses a grid-stride loop: each GPU thread starts at its global index
+// and steps by the size of the grid, so every element is handled exactly once no matter
+// how many blocks are launched.  On a CPU the same guarantee is better served by giving
+// each thread one contiguous slice: a thread walking memory in order gets the hardware
+// prefetcher and full cache lines, and the loop over the slice vectorizes.  So here the
+// "grid" is a handful of std::threads and the stride loop becomes a slice loop.
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined( _MSC_VER )
+    #define CPU_RESTRICT __restrict
+#else
+    #define CPU_RESTRICT __restrict__
+#endif
+
+namespace cpu_backend
+{
+    static const size_t CACHE_LINE = 64;
+
+    // Slices start on multiples of 16 elements (64 bytes of floats, 128 of doubles), so
+    // in an array that starts on a cache line (AlignedArray) no two threads write the
+    // same line.
+    static const size_t SLICE_ALIGN = 16;
+
+    // Cache line aligned and deliberately not initialized: unlike std::vector, allocating
+    // doesn't touch the pages, so whoever writes them first decides where they live.
+    template<typename T>
+    class AlignedArray
+    {
+    public:
+        explicit AlignedArray( const size_t count )
+            : m_Data( static_cast<T*>( ::operator new( count * sizeof( T ), std::align_val_t( CACHE_LINE ) ) ) )
+        {
+        }
+
+        ~AlignedArray()
+        {
+            ::operator delete( m_Data, std::align_val_t( CACHE_LINE ) );
+        }
+
+        AlignedArray( const AlignedArray& ) = delete;
+        AlignedArray& operator=( const AlignedArray& ) = delete;
+
+        T* Data() { return m_Data; }
+        T& operator[]( const size_t i ) { return m_Data[ i ]; }
+
+    private:
+        T* m_Data;
+    };
+
+    inline int ThreadCount()
+    {
+        const unsigned cores = std::thread::hardware_concurrency();
+        return cores ? static_cast<int>( cores ) : 1;
+    }
+
+    // Run kernel( thread, begin, end ) over [0, n) split into thread_count contiguous
+    // slices; thread is the slice number.  The calling thread takes slice 0.
+    template<typename KernelT>
+    void ParallelForThreads( const size_t n, int thread_count, KernelT kernel )
+    {
+        thread_count = std::max( 1, thread_count );
+        const size_t slice = ( ( n / thread_count + SLICE_ALIGN - 1 ) / SLICE_ALIGN ) * SLICE_ALIGN;
+
+        std::vector<std::thread> threads;
+        for( int t = 1; t < thread_count && slice * t < n; ++t )
+        {
+            threads.emplace_back( kernel, t, slice * t, std::min( n, slice * ( t + 1 ) ) );
+        }
+        kernel( 0, size_t( 0 ), std::min( n, slice ) );
+        for( std::thread& thread : threads )
+        {
+            thread.join();
+        }
+    }
+
+    // Same, for kernels that don't care which slice they're on: kernel( begin, end ).
+    template<typename KernelT>
+    void ParallelFor( const size_t n, const int thread_count, KernelT kernel )
+    {
+        ParallelForThreads( n, thread_count, [&kernel]( int, const size_t begin, const size_t end )
+        {
+            kernel( begin, end );
+        } );
+    }
+
+    // y[i] = x[i] + y[i] for every i < n, same as the CUDA kernel.
+    inline void add( int n, float *x, float *y, const int thread_count = ThreadCount() )
+    {
+        ParallelFor( static_cast<size_t>( std::max( n, 0 ) ), thread_count, [x, y]( const size_t begin, const size_t end )
+        {
+            const float* CPU_RESTRICT in = x;
+            float* CPU_RESTRICT out = y;
+            for( size_t i = begin; i < end; ++i )
+            {
+                out[ i ] = in[ i ] + out[ i ];
+            }
+        } );
+    }
+}
@@ -0,0 +1,84 @@
+// cudasample.cu on the CPU: the same add over unified-memory-sized arrays, checked the
+// same way, then timed to see how close it gets to the memory bus's limit.
+//
+// Usage: CUDASample [elements] [threads] [peak GB/s]
+//   peak GB/s is the theoretical memory bandwidth to compare against, which the
+//   program can't find out for itself: memory channels x transfer rate (MT/s) x 8
+//   bytes / 1000, e.g. 2 channels of DDR4-3200 is 51.2.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "cpu_backend.hpp"
+
+// Big enough to be well out of any cache: the GPU sample's 1M elements would fit in
+// L3 on many CPUs and measure cache bandwidth instead of memory bandwidth.
+static const int DEFAULT_ELEMENTS = 1 << 26;
+static const int REP_COUNT = 10;
+
+int main( int argc, char** argv )
+{
+    const int N = ( argc > 1 ) ? std::atoi( argv[ 1 ] ) : DEFAULT_ELEMENTS;
+    const int threads = ( argc > 2 ) ? std::atoi( argv[ 2 ] ) : cpu_backend::ThreadCount();
+    const double peak_gbs = ( argc > 3 ) ? std::atof( argv[ 3 ] ) : 0.0;
+    if( N <= 0 || threads <= 0 )
+    {
+        std::cout << "Usage: CUDASample [elements] [threads] [peak GB/s]" << std::endl;
+        return 1;
+    }
+
+    // Cache line aligned, so the threads' slices don't share lines.
+    cpu_backend::AlignedArray<float> x( N ), y( N );
+
+    // Initialize with the same slices the kernel uses, so each thread's part of the
+    // arrays is first touched (and on NUMA machines, placed) by that thread.
+    cpu_backend::ParallelFor( N, threads, [&x, &y]( const size_t begin, const size_t end )
+    {
+        for( size_t i = begin; i < end; ++i )
+        {
+            x[ i ] = 1.0f;
+            y[ i ] = 2.0f;
+        }
+    } );
+
+    cpu_backend::add( N, x.Data(), y.Data(), threads );
+
+    // Check for errors (all values should be 3.0f)
+    float maxError = 0.0f;
+    for( int i = 0; i < N; i++ )
+    {
+        maxError = std::fmax( maxError, std::fabs( y[ i ] - 3.0f ) );
+    }
+    std::cout << "CPU backend, " << threads << " threads" << std::endl;
+    std::cout << "Max error: " << maxError << std::endl;
+
+    // Each add reads x and y and writes y: 12 bytes per element.
+    std::vector<double> seconds;
+    for( int rep = 0; rep < REP_COUNT; ++rep )
+    {
+        const auto start = std::chrono::steady_clock::now();
+        cpu_backend::add( N, x.Data(), y.Data(), threads );
+        seconds.push_back( std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
+    }
+    std::sort( seconds.begin(), seconds.end() );
+
+    const double bytes = 3.0 * sizeof( float ) * N;
+    const double best_gbs = bytes / seconds.front() / 1e9;
+    const double median_gbs = bytes / seconds[ seconds.size() / 2 ] / 1e9;
+    std::cout << "add over " << N << " elements (" << bytes / ( 1 << 20 ) << " MB moved): best "
+              << best_gbs << " GB/s, median " << median_gbs << " GB/s" << std::endl;
+    if( peak_gbs > 0.0 )
+    {
+        std::cout << "Theoretical " << peak_gbs << " GB/s, achieved " << 100.0 * best_gbs / peak_gbs << "%" << std::endl;
+    }
+    else
+    {
+        std::cout << "Pass the theoretical bandwidth (channels x MT/s x 8 / 1000) as the third argument to compare." << std::endl;
+    }
+
+    return 0;
+}
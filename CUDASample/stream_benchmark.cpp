@@ -0,0 +1,291 @@
+// STREAM style memory bandwidth suite on the CPU.
+//
+// cudasample.cu's add kernel is one of John McCalpin's four STREAM kernels; this runs
+// all four, over arrays far bigger than any cache:
+//   copy   c = a           16 bytes moved per element
+//   scale  b = q * c       16
+//   add    c = a + b       24
+//   triad  a = b + q * c   24
+// Every kernel is timed REP_COUNT times and the best run counts, as in STREAM.
+//
+// Each thread count runs twice: plain stores, and non-temporal (streaming) stores that
+// write around the cache.  A plain store first reads the line it writes into the cache
+// (a "read for ownership"), so copy really moves 24 bytes per element, not 16; that
+// traffic is why streaming stores win on big outputs.  Only SSE2 has a portable
+// intrinsic for them, so elsewhere that row is skipped.
+//
+// Memory is first touched by the thread that will use it (see
+// cpu_backend::AlignedArray), which on a NUMA machine puts each slice on its thread's
+// own node.  With "serial" on the command line one thread touches everything first
+// instead, to see what that costs.
+// "pin" fixes thread t to core t, so the OS can't move threads away from their memory.
+//
+// Usage: StreamBenchmark [elements] [max threads] [serial] [pin]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+    #include <emmintrin.h>
+    #define STREAM_NT_STORES 1
+#else
+    #define STREAM_NT_STORES 0
+#endif
+
+#if defined( _WIN32 )
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#elif defined( __linux__ )
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+#include "cpu_backend.hpp"
+
+// 2^25 doubles is 256 MB per array.  STREAM's rule is at least 4x the caches.
+static const size_t DEFAULT_ELEMENTS = size_t( 1 ) << 25;
+static const int REP_COUNT = 10;
+static const double SCALAR = 3.0;
+
+enum Kernel { COPY, SCALE, ADD, TRIAD, KERNEL_COUNT };
+
+static const char* KERNEL_NAMES[ KERNEL_COUNT ] = { "copy", "scale", "add", "triad" };
+static const int KERNEL_BYTES[ KERNEL_COUNT ] = { 16, 16, 24, 24 };
+
+static void PinToCpu( const int cpu )
+{
+    const int cores = cpu_backend::ThreadCount();
+#if defined( _WIN32 )
+    SetThreadAffinityMask( GetCurrentThread(), DWORD_PTR( 1 ) << ( cpu % cores ) );
+#elif defined( __linux__ )
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    CPU_SET( cpu % cores, &set );
+    pthread_setaffinity_np( pthread_self(), sizeof( set ), &set );
+#else
+    (void)cpu;
+    (void)cores;
+#endif
+}
+
+#if defined( __linux__ ) || defined( _WIN32 )
+static const bool CAN_PIN = true;
+#else
+static const bool CAN_PIN = false;
+#endif
+
+// One kernel over [begin, end).  begin is a multiple of cpu_backend::SLICE_ALIGN, so
+// with 64 byte aligned arrays every slice starts 16 byte aligned for the SSE2 stores.
+static void RunSlice( const Kernel kernel, const bool streaming, double* a, double* b, double* c, size_t begin, const size_t end )
+{
+    double* CPU_RESTRICT out = ( kernel == COPY || kernel == ADD ) ? c : ( kernel == SCALE ? b : a );
+
+#if STREAM_NT_STORES
+    if( streaming )
+    {
+        const __m128d q = _mm_set1_pd( SCALAR );
+        const size_t pairs_end = begin + ( ( end - begin ) & ~size_t( 1 ) );
+        for( size_t i = begin; i < pairs_end; i += 2 )
+        {
+            __m128d value;
+            switch( kernel )
+            {
+                case COPY:  value = _mm_load_pd( &a[ i ] ); break;
+                case SCALE: value = _mm_mul_pd( q, _mm_load_pd( &c[ i ] ) ); break;
+                case ADD:   value = _mm_add_pd( _mm_load_pd( &a[ i ] ), _mm_load_pd( &b[ i ] ) ); break;
+                default:    value = _mm_add_pd( _mm_load_pd( &b[ i ] ), _mm_mul_pd( q, _mm_load_pd( &c[ i ] ) ) ); break;
+            }
+            _mm_stream_pd( &out[ i ], value );
+        }
+        _mm_sfence();   // streaming stores are weakly ordered; finish them before the join
+        begin = pairs_end;
+    }
+#else
+    (void)streaming;
+#endif
+
+    // Separate loops so each one vectorizes; the switch is outside them.
+    const double* CPU_RESTRICT in_a = a;
+    const double* CPU_RESTRICT in_b = b;
+    const double* CPU_RESTRICT in_c = c;
+    switch( kernel )
+    {
+        case COPY:
+            for( size_t i = begin; i < end; ++i ) out[ i ] = in_a[ i ];
+            break;
+        case SCALE:
+            for( size_t i = begin; i < end; ++i ) out[ i ] = SCALAR * in_c[ i ];
+            break;
+        case ADD:
+            for( size_t i = begin; i < end; ++i ) out[ i ] = in_a[ i ] + in_b[ i ];
+            break;
+        default:
+            for( size_t i = begin; i < end; ++i ) out[ i ] = in_b[ i ] + SCALAR * in_c[ i ];
+            break;
+    }
+}
+
+struct RunSettings
+{
+    size_t elements;
+    int    threads;
+    bool   streaming;
+    bool   serial_init;
+    bool   pin;
+};
+
+// Best GB/s for each kernel.  Returns false if the arrays come out wrong.
+static bool RunStream( const RunSettings& settings, double ( &best_gbs )[ KERNEL_COUNT ] )
+{
+    const size_t n = settings.elements;
+    cpu_backend::AlignedArray<double> a_array( n ), b_array( n ), c_array( n );
+    double* a = a_array.Data();
+    double* b = b_array.Data();
+    double* c = c_array.Data();
+
+    auto init = [a, b, c]( const size_t begin, const size_t end )
+    {
+        for( size_t i = begin; i < end; ++i )
+        {
+            a[ i ] = 1.0;
+            b[ i ] = 2.0;
+            c[ i ] = 0.0;
+        }
+    };
+    if( settings.serial_init )
+    {
+        init( 0, n );
+    }
+    else
+    {
+        cpu_backend::ParallelForThreads( n, settings.threads, [&settings, &init]( const int thread, const size_t begin, const size_t end )
+        {
+            if( settings.pin )
+            {
+                PinToCpu( thread );
+            }
+            init( begin, end );
+        } );
+    }
+
+    double best_seconds[ KERNEL_COUNT ];
+    std::fill( std::begin( best_seconds ), std::end( best_seconds ), 1e30 );
+    for( int rep = 0; rep < REP_COUNT; ++rep )
+    {
+        for( int kernel = 0; kernel < KERNEL_COUNT; ++kernel )
+        {
+            const auto start = std::chrono::steady_clock::now();
+            cpu_backend::ParallelForThreads( n, settings.threads, [&]( const int thread, const size_t begin, const size_t end )
+            {
+                if( settings.pin )
+                {
+                    PinToCpu( thread );
+                }
+                RunSlice( static_cast<Kernel>( kernel ), settings.streaming, a, b, c, begin, end );
+            } );
+            const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+            best_seconds[ kernel ] = std::min( best_seconds[ kernel ], seconds );
+        }
+    }
+
+    for( int kernel = 0; kernel < KERNEL_COUNT; ++kernel )
+    {
+        best_gbs[ kernel ] = double( KERNEL_BYTES[ kernel ] ) * n / best_seconds[ kernel ] / 1e9;
+    }
+
+    // STREAM's check: run the same sequence on one element's worth of scalars.
+    double a_expected = 1.0, b_expected = 2.0, c_expected = 0.0;
+    for( int rep = 0; rep < REP_COUNT; ++rep )
+    {
+        c_expected = a_expected;
+        b_expected = SCALAR * c_expected;
+        c_expected = a_expected + b_expected;
+        a_expected = b_expected + SCALAR * c_expected;
+    }
+    double a_error = 0.0, b_error = 0.0, c_error = 0.0;
+    for( size_t i = 0; i < n; ++i )
+    {
+        a_error += std::fabs( a[ i ] - a_expected );
+        b_error += std::fabs( b[ i ] - b_expected );
+        c_error += std::fabs( c[ i ] - c_expected );
+    }
+    const double tolerance = 1e-13 * n;
+    return a_error <= tolerance * a_expected && b_error <= tolerance * b_expected && c_error <= tolerance * c_expected;
+}
+
+static void PrintRow( const char* label, const int threads, const double ( &gbs )[ KERNEL_COUNT ], const bool ok )
+{
+    char line[ 128 ];
+    snprintf( line, sizeof( line ), "%-10s %7d %9.1f %9.1f %9.1f %9.1f%s", label, threads,
+              gbs[ COPY ], gbs[ SCALE ], gbs[ ADD ], gbs[ TRIAD ], ok ? "" : "  FAILED VALIDATION" );
+    std::cout << line << std::endl;
+}
+
+int main( int argc, char** argv )
+{
+    RunSettings settings = { DEFAULT_ELEMENTS, 0, false, false, false };
+    int max_threads = cpu_backend::ThreadCount();
+    int number = 0;
+    for( int arg = 1; arg < argc; ++arg )
+    {
+        if( !strcmp( argv[ arg ], "serial" ) )
+        {
+            settings.serial_init = true;
+        }
+        else if( !strcmp( argv[ arg ], "pin" ) )
+        {
+            settings.pin = CAN_PIN;
+        }
+        else if( number++ == 0 )
+        {
+            settings.elements = static_cast<size_t>( std::strtoull( argv[ arg ], nullptr, 10 ) );
+        }
+        else
+        {
+            max_threads = std::atoi( argv[ arg ] );
+        }
+    }
+    if( settings.elements < cpu_backend::SLICE_ALIGN || max_threads <= 0 )
+    {
+        std::cout << "Usage: StreamBenchmark [elements] [max threads] [serial] [pin]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "STREAM: " << settings.elements << " doubles per array (" << 3.0 * sizeof( double ) * settings.elements / ( 1 << 20 )
+              << " MB total), best of " << REP_COUNT << ", first touch " << ( settings.serial_init ? "serial" : "by each thread" )
+              << ( settings.pin ? ", pinned" : "" ) << std::endl;
+    char header[ 128 ];
+    snprintf( header, sizeof( header ), "%-10s %7s %9s %9s %9s %9s", "GB/s", "threads",
+              KERNEL_NAMES[ COPY ], KERNEL_NAMES[ SCALE ], KERNEL_NAMES[ ADD ], KERNEL_NAMES[ TRIAD ] );
+    std::cout << header << std::endl;
+
+    // 1, 2, 4, ... threads, and the maximum if it isn't a power of 2.
+    std::vector<int> sweep;
+    for( int threads = 1; threads < max_threads; threads *= 2 )
+    {
+        sweep.push_back( threads );
+    }
+    sweep.push_back( max_threads );
+
+    bool all_ok = true;
+    for( const int threads : sweep )
+    {
+        settings.threads = threads;
+        for( int streaming = 0; streaming <= STREAM_NT_STORES; ++streaming )
+        {
+            settings.streaming = ( streaming != 0 );
+            double gbs[ KERNEL_COUNT ];
+            const bool ok = RunStream( settings, gbs );
+            PrintRow( streaming ? "streaming" : "plain", threads, gbs, ok );
+            all_ok = all_ok && ok;
+        }
+    }
+
+    return all_ok ? 0 : 1;
+}
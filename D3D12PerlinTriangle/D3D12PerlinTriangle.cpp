@@ -11,6 +11,7 @@
 
 #include "stdafx.h"
 #include "D3D12PerlinTriangle.h"
+#include "texture_generator.hpp"
 
 D3D12PerlinTriangle::D3D12PerlinTriangle( UINT width, UINT height, std::wstring name ) :
     DXSample( width, height, name ),
@@ -492,6 +493,30 @@ void D3D12PerlinTriangle::LoadAssets()
         srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
         srvDesc.Texture2D.MipLevels = 1;
         m_device->CreateShaderResourceView( m_texture.Get(), &srvDesc, m_srvHeap->GetCPUDescriptorHandleForHeapStart() );
+
+        // Upload buffers for the animated texture, one per frame, mapped for good.
+        if( AnimateTexture )
+        {
+            m_device->GetCopyableFootprints( &textureDesc, 0, 1, 0, &m_textureFootprint, nullptr, nullptr, nullptr );
+            for( UINT n = 0; n < FrameCount; n++ )
+            {
+                ThrowIfFailed( m_device->CreateCommittedResource(
+                    &CD3DX12_HEAP_PROPERTIES( D3D12_HEAP_TYPE_UPLOAD ),
+                    D3D12_HEAP_FLAG_NONE,
+                    &CD3DX12_RESOURCE_DESC::Buffer( uploadBufferSize ),
+                    D3D12_RESOURCE_STATE_GENERIC_READ,
+                    nullptr,
+                    IID_PPV_ARGS( &m_textureUpload[ n ] ) ) );
+
+                CD3DX12_RANGE readRange( 0, 0 );    // We do not intend to read from these buffers on the CPU.
+                ThrowIfFailed( m_textureUpload[ n ]->Map( 0, &readRange, reinterpret_cast<void**>( &m_textureUploadData[ n ] ) ) );
+            }
+
+            texture_gen::TextureSettings settings;
+            settings.width = TextureWidth;
+            settings.height = TextureHeight;
+            m_animatedTexture = std::make_unique<texture_gen::AnimatedTexture>( settings );
+        }
     }
 
     // Close the command list and execute it to begin the initial GPU setup.
@@ -521,66 +546,22 @@ void D3D12PerlinTriangle::LoadAssets()
 // Generate a simple black and white checkerboard texture.
 std::vector<UINT8> D3D12PerlinTriangle::GenerateTextureData()
 {
-    const UINT rowPitch = TextureWidth * TexturePixelSize;
-    const UINT cellPitch = rowPitch >> 3;      // The width of a cell in the checkerboard texture.
-    const UINT cellHeight = TextureWidth >> 3; // The height of a cell in the checkerboard texture.
-    const UINT textureSize = rowPitch * TextureHeight;
-
-    std::vector<UINT8> data( textureSize );
-    UINT8* pData = &data[ 0 ];
-
-    for( UINT n = 0; n < textureSize; n += TexturePixelSize )
-    {
-        UINT x = n % rowPitch;
-        UINT y = n / rowPitch;
-        UINT i = x / cellPitch;
-        UINT j = y / cellHeight;
-
-        if( i % 2 == j % 2 )
-        {
-            pData[ n ] = 0x00;        // R
-            pData[ n + 1 ] = 0x00;    // G
-            pData[ n + 2 ] = 0x00;    // B
-            pData[ n + 3 ] = 0xff;    // A
-        }
-        else
-        {
-            pData[ n ] = 0xff;        // R
-            pData[ n + 1 ] = 0xff;    // G
-            pData[ n + 2 ] = 0xff;    // B
-            pData[ n + 3 ] = 0xff;    // A
-        }
-    }
-
-    return data;
+    texture_gen::TextureSettings settings;
+    settings.width = TextureWidth;
+    settings.height = TextureHeight;
+    settings.pattern = texture_gen::Pattern::Checkerboard;
+    return texture_gen::GenerateRGBA( settings );
 }
 
-// Generate a simple black and white checkerboard texture.
+// Generate a grayscale Perlin noise texture.
+// Texture coordinates are normalized to the range [0, 1], and z is ( x + y ) / 2.
 std::vector<UINT8> D3D12PerlinTriangle::GeneratePerlinTextureData()
 {
-    const UINT rowPitch = TextureWidth * TexturePixelSize;
-    const UINT textureSize = rowPitch * TextureHeight;
-    std::vector<UINT8> data( textureSize );
-
-    for( size_t n = 0; n < textureSize; n += TexturePixelSize )
-    {
-        // Calculate a Perlin noise value based on texture coordinates.
-        // Texture coordinates are normalized to the range [0, 1].
-        float x = static_cast<float>( n % rowPitch ) / static_cast<float>( rowPitch );
-        float y = static_cast<float>( n / rowPitch ) / static_cast<float>( TextureHeight );
-        float noise = stb_perlin_noise3( x, y, ( x + y ) / 2.0f, 0, 0, 0 );
-
-        // Convert the noise value to an offset from a fixed color.
-        // The noise value is in the range [-1, 1], so scale it to [0, 255].
-        UINT8 full_color = static_cast<UINT8>( ( noise + 1 ) * 128.0f );
-
-        data.at( n )     = full_color; // R
-        data.at( n + 1 ) = full_color; // G
-        data.at( n + 2 ) = full_color; // B
-        data.at( n + 3 ) = 0xff;       // A
-    }
-
-    return data;
+    texture_gen::TextureSettings settings;
+    settings.width = TextureWidth;
+    settings.height = TextureHeight;
+    settings.pattern = texture_gen::Pattern::Perlin;
+    return texture_gen::GenerateRGBA( settings );
 }
 
 // Update frame-based values.
@@ -614,6 +595,16 @@ void D3D12PerlinTriangle::OnUpdate()
         // Release the local copy of the vertex data.
         m_vertexBuffer->Unmap( 0, nullptr );
     }
+
+    // Write this frame's slice of the background noise into its upload buffer; only
+    // the pixels whose z crossed a noise lattice cell are rebuilt.
+    if( AnimateTexture )
+    {
+        static const float msPerSecond = 1000.0f; // milliseconds per second
+
+        const float z = GetElapsedTimeMs() / msPerSecond * TextureNoiseSpeed;
+        m_animatedTexture->Render( z, m_textureUploadData[ m_frameIndex ] + m_textureFootprint.Offset, m_textureFootprint.Footprint.RowPitch );
+    }
 }
 
 // Render the scene.
@@ -663,6 +654,28 @@ void D3D12PerlinTriangle::PopulateCommandList()
     m_commandList->RSSetViewports( 1, &m_viewport );
     m_commandList->RSSetScissorRects( 1, &m_scissorRect );
 
+    // Copy this frame's slice of the animated noise into the texture.
+    if( AnimateTexture )
+    {
+        m_commandList->ResourceBarrier(
+            1,
+            &CD3DX12_RESOURCE_BARRIER::Transition(
+                m_texture.Get(),
+                D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+                D3D12_RESOURCE_STATE_COPY_DEST ) );
+
+        CD3DX12_TEXTURE_COPY_LOCATION destination( m_texture.Get(), 0 );
+        CD3DX12_TEXTURE_COPY_LOCATION source( m_textureUpload[ m_frameIndex ].Get(), m_textureFootprint );
+        m_commandList->CopyTextureRegion( &destination, 0, 0, 0, &source, nullptr );
+
+        m_commandList->ResourceBarrier(
+            1,
+            &CD3DX12_RESOURCE_BARRIER::Transition(
+                m_texture.Get(),
+                D3D12_RESOURCE_STATE_COPY_DEST,
+                D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE ) );
+    }
+
     // Indicate that the back buffer will be used as a render target.
     m_commandList->ResourceBarrier(
         1,
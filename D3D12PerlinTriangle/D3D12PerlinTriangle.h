@@ -11,7 +11,10 @@
 
 #pragma once
 
+#include <memory>
+
 #include "DXSample.h"
+#include "animated_texture.hpp"
 
 using namespace DirectX;
 
@@ -37,6 +40,8 @@ private:
     static const UINT TextureWidth = 256;
     static const UINT TextureHeight = 256;
     static const UINT TexturePixelSize = 4;    // The number of bytes used to represent a pixel in the texture.
+    static const bool AnimateTexture = true;   // Move the Perlin background through z every frame.
+    static constexpr float TextureNoiseSpeed = 0.5f;   // z units per second.
 
     struct Vertex
     {
@@ -73,6 +78,13 @@ private:
     D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
     ComPtr<ID3D12Resource> m_texture;
 
+    // The animated background: each frame's slice goes into that frame's upload buffer
+    // (kept mapped), so the CPU never writes one a copy may still be reading.
+    std::unique_ptr<texture_gen::AnimatedTexture> m_animatedTexture;
+    ComPtr<ID3D12Resource> m_textureUpload[FrameCount];
+    UINT8* m_textureUploadData[FrameCount];
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT m_textureFootprint;
+
     // Synchronization objects.
     UINT m_frameIndex;
     HANDLE m_fenceEvent;
@@ -0,0 +1,124 @@
+#include "animated_texture.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+
+#include "perlin_batch.hpp"
+#include "worker_pool.hpp"
+
+namespace texture_gen
+{
+
+namespace
+{
+    // Rows per piece of work handed to a thread.
+    static const size_t BAND_ROWS = 16;
+
+    // Columns checked at once for pixels that changed cell.  z only moves a little
+    // between frames, so those are a few short runs a row.
+    static const int CHECK_COLUMNS = 64;
+
+    // A cell no z floors to, so the first frame builds every pixel.
+    static const int NO_CELL = INT_MIN;
+}
+
+AnimatedTexture::AnimatedTexture( const TextureSettings& settings, WorkerPool& pool ) :
+    m_Settings( settings ),
+    m_Pool( &pool )
+{
+    m_Settings.pattern = Pattern::Perlin;
+    const size_t pixels = m_Settings.width * m_Settings.height;
+    m_Lower.resize( pixels );
+    m_LowerDz.resize( pixels );
+    m_Upper.resize( pixels );
+    m_UpperDz.resize( pixels );
+    m_Cell.assign( pixels, NO_CELL );
+}
+
+size_t AnimatedTexture::Render( const float z, uint8_t* rgba, const size_t row_pitch )
+{
+    const size_t band_count = ( m_Settings.height + BAND_ROWS - 1 ) / BAND_ROWS;
+
+    std::atomic<size_t> total_rebuilt{ 0 };
+    m_Pool->Run( band_count, ThreadsFor( m_Settings ), [&]( const size_t band )
+    {
+        thread_local std::vector<float> noise;
+        if( noise.size() < m_Settings.width )
+        {
+            noise.resize( m_Settings.width );
+        }
+
+        size_t rebuilt = 0;
+        const size_t row_begin = band * BAND_ROWS;
+        RenderRows( z, row_begin, std::min( row_begin + BAND_ROWS, m_Settings.height ), rgba, row_pitch, noise.data(), rebuilt );
+        total_rebuilt += rebuilt;
+    } );
+
+    m_Settings.z = z;
+    return total_rebuilt;
+}
+
+void AnimatedTexture::RenderRows( const float z, const size_t row_begin, const size_t row_end, uint8_t* rgba, const size_t row_pitch,
+                                  float* noise, size_t& rebuilt )
+{
+    // GenerateRGBA's coordinates: x, y across [0, scale), z = z + ( x + y ) / 2.
+    const float dx = m_Settings.scale / static_cast<float>( m_Settings.width );
+    const float dz = dx / 2.0f;
+
+    // int columns and values, which convert to and from float in SIMD registers.
+    const int width = static_cast<int>( m_Settings.width );
+    for( size_t row = row_begin; row < row_end; ++row )
+    {
+        const float y = static_cast<float>( row ) * m_Settings.scale / static_cast<float>( m_Settings.height );
+        const float z0 = z + y / 2.0f;
+        float* lower = &m_Lower[ row * width ];
+        float* lower_dz = &m_LowerDz[ row * width ];
+        float* upper = &m_Upper[ row * width ];
+        float* upper_dz = &m_UpperDz[ row * width ];
+        int* cell = &m_Cell[ row * width ];
+
+        // Find the pixels whose z left their cell, a block at a time, and rebuild them.
+        for( int block = 0; block < width; block += CHECK_COLUMNS )
+        {
+            const int block_end = std::min( block + CHECK_COLUMNS, width );
+            int stale = 0;
+            for( int column = block; column < block_end; ++column )
+            {
+                stale |= perlin_batch::ZCellFloor( z0 + static_cast<float>( column ) * dz ) != cell[ column ];
+            }
+            if( !stale )
+            {
+                continue;
+            }
+
+            for( int column = block; column < block_end; ++column )
+            {
+                const float index = static_cast<float>( column );
+                const float pixel_z = z0 + index * dz;
+                if( perlin_batch::ZCellFloor( pixel_z ) != cell[ column ] )
+                {
+                    const perlin_batch::ZCell rebuilt_cell = perlin_batch::MakeZCell( index * dx, y, pixel_z );
+                    lower[ column ] = rebuilt_cell.lower;
+                    lower_dz[ column ] = rebuilt_cell.lower_dz;
+                    upper[ column ] = rebuilt_cell.upper;
+                    upper_dz[ column ] = rebuilt_cell.upper_dz;
+                    cell[ column ] = rebuilt_cell.cell;
+                    ++rebuilt;
+                }
+            }
+        }
+
+        // Noise is in [-1, 1]; the app's mapping to 0..255, stored as a whole gray,
+        // opaque RGBA pixel.
+        perlin_batch::EvaluateZCellRow( { lower, lower_dz, upper, upper_dz, cell }, z0, dz, noise, m_Settings.width );
+        uint32_t* pixels = reinterpret_cast<uint32_t*>( rgba + row * row_pitch );
+        for( int column = 0; column < width; ++column )
+        {
+            const int gray = static_cast<int>( std::min( 255.0f, std::max( 0.0f, ( noise[ column ] + 1 ) * 128.0f ) ) );
+            pixels[ column ] = 0xff000000u | static_cast<uint32_t>( gray * 0x010101 );
+        }
+    }
+}
+
+}
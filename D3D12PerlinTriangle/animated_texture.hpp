@@ -0,0 +1,50 @@
+#pragma once
+// A Perlin noise texture animated through z, regenerated incrementally.
+//
+// Every pixel keeps the z-independent part of its noise (perlin_batch::ZCell, the x/y
+// interpolated gradients of the two lattice planes either side of its z).  A frame
+// only evaluates those along z, a few multiply-adds a pixel; a pixel's cell is rebuilt
+// when its z moves into the next lattice cell, which for a smooth animation is a small
+// fraction of the pixels per frame.  The result matches GenerateRGBA with the same
+// settings and z, to within a byte of rounding.
+//
+// Frames are written straight into the caller's buffer (an upload buffer, say) with
+// any row pitch.  Bands of rows go to the same worker pool as GenerateRGBA's tiles, and
+// with threads = 0 a small texture is rendered on the calling thread alone.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "texture_generator.hpp"
+
+namespace texture_gen
+{
+    class AnimatedTexture
+    {
+    public:
+        // Pattern::Perlin only; Render supplies z, and Settings().z is the last frame's.
+        // Frames are rendered on pool's threads.
+        explicit AnimatedTexture( const TextureSettings& settings, WorkerPool& pool = WorkerPool::Shared() );
+
+        // Writes the frame at z into rgba (4 byte aligned), rows row_pitch bytes apart
+        // (a multiple of 4), and returns how many pixels had to be rebuilt.
+        size_t Render( float z, uint8_t* rgba, size_t row_pitch );
+
+        const TextureSettings& Settings() const { return m_Settings; }
+
+    private:
+        void RenderRows( float z, size_t row_begin, size_t row_end, uint8_t* rgba, size_t row_pitch, float* noise, size_t& rebuilt );
+
+        TextureSettings    m_Settings;
+        WorkerPool*        m_Pool;
+
+        // perlin_batch::ZCell per pixel, width * height with rows packed, split into
+        // arrays so a frame's loops vectorize.
+        std::vector<float> m_Lower;
+        std::vector<float> m_LowerDz;
+        std::vector<float> m_Upper;
+        std::vector<float> m_UpperDz;
+        std::vector<int>   m_Cell;
+    };
+}
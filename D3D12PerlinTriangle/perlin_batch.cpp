@@ -0,0 +1,468 @@
+#include "perlin_batch.hpp"
+
+#define STB_PERLIN_IMPLEMENTATION
+#include "stb_perlin.h"
+
+#include <cstdint>
+
+#if defined( __x86_64__ ) || defined( _M_X64 )
+    #if defined( _MSC_VER )
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    #define PERLIN_X64 1
+#endif
+
+// MSVC lets any function use any instruction set; GCC and Clang need to be told.
+#if defined( _MSC_VER ) && !defined( __clang__ )
+    #define PERLIN_TARGET( isa )
+#else
+    #define PERLIN_TARGET( isa ) __attribute__( ( target( isa ) ) )
+#endif
+
+namespace perlin_batch
+{
+
+namespace
+{
+    struct Wrap
+    {
+        int x_mask;
+        int y_mask;
+        int z_mask;
+        int seed;
+    };
+
+    Wrap MakeWrap( const int x_wrap, const int y_wrap, const int z_wrap, const int seed )
+    {
+        // Same masks as stb_perlin_noise3_internal; the seed is a byte there too.
+        return Wrap{ ( x_wrap - 1 ) & 255, ( y_wrap - 1 ) & 255, ( z_wrap - 1 ) & 255, static_cast<unsigned char>( seed ) };
+    }
+
+    void NoiseScalar( const float* x, const float* y, const float* z, float* out, const size_t count,
+                      const int x_wrap, const int y_wrap, const int z_wrap, const Wrap& wrap )
+    {
+        for( size_t i = 0; i < count; ++i )
+        {
+            out[ i ] = stb_perlin_noise3_internal( x[ i ], y[ i ], z[ i ], x_wrap, y_wrap, z_wrap, static_cast<unsigned char>( wrap.seed ) );
+        }
+    }
+
+#if PERLIN_X64
+    inline __m128i Floor4( const __m128 a, __m128& fraction )
+    {
+        // stb__perlin_fastfloor: truncate, then step down if that went up.
+        __m128i ai = _mm_cvttps_epi32( a );
+        ai = _mm_add_epi32( ai, _mm_castps_si128( _mm_cmplt_ps( a, _mm_cvtepi32_ps( ai ) ) ) );
+        fraction = _mm_sub_ps( a, _mm_cvtepi32_ps( ai ) );
+        return ai;
+    }
+
+    inline __m128 Ease4( const __m128 t )
+    {
+        __m128 e = _mm_sub_ps( _mm_mul_ps( t, _mm_set1_ps( 6.0f ) ), _mm_set1_ps( 15.0f ) );
+        e = _mm_add_ps( _mm_mul_ps( e, t ), _mm_set1_ps( 10.0f ) );
+        return _mm_mul_ps( _mm_mul_ps( _mm_mul_ps( e, t ), t ), t );
+    }
+
+    inline __m128 Lerp4( const __m128 a, const __m128 b, const __m128 t )
+    {
+        return _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps( b, a ), t ) );
+    }
+
+    inline __m128 Select4( const __m128i mask, const __m128 a, const __m128 b )
+    {
+        const __m128 m = _mm_castsi128_ps( mask );
+        return _mm_or_ps( _mm_and_ps( m, a ), _mm_andnot_ps( m, b ) );
+    }
+
+    // stb's basis table, read without a lookup: gradient g is +-u +-v where u is x for
+    // g < 8 and y after, v is y for g < 4 and z after; bit 0 of g flips u, bit 1 flips v.
+    inline __m128 Grad4( const __m128i g, const __m128 x, const __m128 y, const __m128 z )
+    {
+        const __m128 u = Select4( _mm_cmplt_epi32( g, _mm_set1_epi32( 8 ) ), x, y );
+        const __m128 v = Select4( _mm_cmplt_epi32( g, _mm_set1_epi32( 4 ) ), y, z );
+        const __m128 u_sign = _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( g, _mm_set1_epi32( 1 ) ), 31 ) );
+        const __m128 v_sign = _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( g, _mm_set1_epi32( 2 ) ), 30 ) );
+        return _mm_add_ps( _mm_xor_ps( u, u_sign ), _mm_xor_ps( v, v_sign ) );
+    }
+
+    __m128 Noise4( __m128 x, __m128 y, __m128 z, const Wrap& wrap )
+    {
+        const __m128i px = Floor4( x, x );
+        const __m128i py = Floor4( y, y );
+        const __m128i pz = Floor4( z, z );
+        const __m128 u = Ease4( x );
+        const __m128 v = Ease4( y );
+        const __m128 w = Ease4( z );
+
+        // SSE2 has no gather, so the hashing is scalar, lane by lane.
+        alignas( 16 ) int32_t lx[ 4 ], ly[ 4 ], lz[ 4 ];
+        _mm_store_si128( reinterpret_cast<__m128i*>( lx ), px );
+        _mm_store_si128( reinterpret_cast<__m128i*>( ly ), py );
+        _mm_store_si128( reinterpret_cast<__m128i*>( lz ), pz );
+
+        alignas( 16 ) int32_t grad[ 8 ][ 4 ];
+        for( int lane = 0; lane < 4; ++lane )
+        {
+            const int x0 = lx[ lane ] & wrap.x_mask, x1 = ( lx[ lane ] + 1 ) & wrap.x_mask;
+            const int y0 = ly[ lane ] & wrap.y_mask, y1 = ( ly[ lane ] + 1 ) & wrap.y_mask;
+            const int z0 = lz[ lane ] & wrap.z_mask, z1 = ( lz[ lane ] + 1 ) & wrap.z_mask;
+
+            const int r0 = stb__perlin_randtab[ x0 + wrap.seed ];
+            const int r1 = stb__perlin_randtab[ x1 + wrap.seed ];
+            const int r00 = stb__perlin_randtab[ r0 + y0 ];
+            const int r01 = stb__perlin_randtab[ r0 + y1 ];
+            const int r10 = stb__perlin_randtab[ r1 + y0 ];
+            const int r11 = stb__perlin_randtab[ r1 + y1 ];
+
+            grad[ 0 ][ lane ] = stb__perlin_randtab_grad_idx[ r00 + z0 ];
+            grad[ 1 ][ lane ] = stb__perlin_randtab_grad_idx[ r00 + z1 ];
+            grad[ 2 ][ lane ] = stb__perlin_randtab_grad_idx[ r01 + z0 ];
+            grad[ 3 ][ lane ] = stb__perlin_randtab_grad_idx[ r01 + z1 ];
+            grad[ 4 ][ lane ] = stb__perlin_randtab_grad_idx[ r10 + z0 ];
+            grad[ 5 ][ lane ] = stb__perlin_randtab_grad_idx[ r10 + z1 ];
+            grad[ 6 ][ lane ] = stb__perlin_randtab_grad_idx[ r11 + z0 ];
+            grad[ 7 ][ lane ] = stb__perlin_randtab_grad_idx[ r11 + z1 ];
+        }
+
+        const __m128 one = _mm_set1_ps( 1.0f );
+        const __m128 x1 = _mm_sub_ps( x, one );
+        const __m128 y1 = _mm_sub_ps( y, one );
+        const __m128 z1 = _mm_sub_ps( z, one );
+        auto g = [&grad]( const int corner ) { return _mm_load_si128( reinterpret_cast<const __m128i*>( grad[ corner ] ) ); };
+
+        const __m128 n00 = Lerp4( Grad4( g( 0 ), x, y, z ), Grad4( g( 1 ), x, y, z1 ), w );
+        const __m128 n01 = Lerp4( Grad4( g( 2 ), x, y1, z ), Grad4( g( 3 ), x, y1, z1 ), w );
+        const __m128 n10 = Lerp4( Grad4( g( 4 ), x1, y, z ), Grad4( g( 5 ), x1, y, z1 ), w );
+        const __m128 n11 = Lerp4( Grad4( g( 6 ), x1, y1, z ), Grad4( g( 7 ), x1, y1, z1 ), w );
+
+        return Lerp4( Lerp4( n00, n01, v ), Lerp4( n10, n11, v ), u );
+    }
+
+    // The AVX2 path gathers from 32 bit copies of stb's byte tables.
+    struct WideTables
+    {
+        int32_t randtab[ 512 ];
+        int32_t grad_idx[ 512 ];
+
+        WideTables()
+        {
+            for( int i = 0; i < 512; ++i )
+            {
+                randtab[ i ] = stb__perlin_randtab[ i ];
+                grad_idx[ i ] = stb__perlin_randtab_grad_idx[ i ];
+            }
+        }
+    };
+
+    const WideTables& GetWideTables()
+    {
+        static const WideTables tables;
+        return tables;
+    }
+
+    PERLIN_TARGET( "avx2" ) inline __m256i Floor8( const __m256 a, __m256& fraction )
+    {
+        __m256i ai = _mm256_cvttps_epi32( a );
+        ai = _mm256_add_epi32( ai, _mm256_castps_si256( _mm256_cmp_ps( a, _mm256_cvtepi32_ps( ai ), _CMP_LT_OQ ) ) );
+        fraction = _mm256_sub_ps( a, _mm256_cvtepi32_ps( ai ) );
+        return ai;
+    }
+
+    PERLIN_TARGET( "avx2" ) inline __m256 Ease8( const __m256 t )
+    {
+        __m256 e = _mm256_sub_ps( _mm256_mul_ps( t, _mm256_set1_ps( 6.0f ) ), _mm256_set1_ps( 15.0f ) );
+        e = _mm256_add_ps( _mm256_mul_ps( e, t ), _mm256_set1_ps( 10.0f ) );
+        return _mm256_mul_ps( _mm256_mul_ps( _mm256_mul_ps( e, t ), t ), t );
+    }
+
+    PERLIN_TARGET( "avx2" ) inline __m256 Lerp8( const __m256 a, const __m256 b, const __m256 t )
+    {
+        return _mm256_add_ps( a, _mm256_mul_ps( _mm256_sub_ps( b, a ), t ) );
+    }
+
+    PERLIN_TARGET( "avx2" ) inline __m256 Grad8( const __m256i g, const __m256 x, const __m256 y, const __m256 z )
+    {
+        const __m256 u = _mm256_blendv_ps( y, x, _mm256_castsi256_ps( _mm256_cmpgt_epi32( _mm256_set1_epi32( 8 ), g ) ) );
+        const __m256 v = _mm256_blendv_ps( z, y, _mm256_castsi256_ps( _mm256_cmpgt_epi32( _mm256_set1_epi32( 4 ), g ) ) );
+        const __m256 u_sign = _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_and_si256( g, _mm256_set1_epi32( 1 ) ), 31 ) );
+        const __m256 v_sign = _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_and_si256( g, _mm256_set1_epi32( 2 ) ), 30 ) );
+        return _mm256_add_ps( _mm256_xor_ps( u, u_sign ), _mm256_xor_ps( v, v_sign ) );
+    }
+
+    // table[ a + b ] per lane.
+    PERLIN_TARGET( "avx2" ) inline __m256i Lookup8( const int32_t* table, const __m256i a, const __m256i b )
+    {
+        return _mm256_i32gather_epi32( table, _mm256_add_epi32( a, b ), 4 );
+    }
+
+    PERLIN_TARGET( "avx2" ) __m256 Noise8( __m256 x, __m256 y, __m256 z, const Wrap& wrap, const WideTables& tables )
+    {
+        const __m256i px = Floor8( x, x );
+        const __m256i py = Floor8( y, y );
+        const __m256i pz = Floor8( z, z );
+        const __m256 u = Ease8( x );
+        const __m256 v = Ease8( y );
+        const __m256 w = Ease8( z );
+
+        const __m256i one_i = _mm256_set1_epi32( 1 );
+        const __m256i x_mask = _mm256_set1_epi32( wrap.x_mask );
+        const __m256i y_mask = _mm256_set1_epi32( wrap.y_mask );
+        const __m256i z_mask = _mm256_set1_epi32( wrap.z_mask );
+        const __m256i seed = _mm256_set1_epi32( wrap.seed );
+        const __m256i x0 = _mm256_and_si256( px, x_mask ), x1 = _mm256_and_si256( _mm256_add_epi32( px, one_i ), x_mask );
+        const __m256i y0 = _mm256_and_si256( py, y_mask ), y1 = _mm256_and_si256( _mm256_add_epi32( py, one_i ), y_mask );
+        const __m256i z0 = _mm256_and_si256( pz, z_mask ), z1 = _mm256_and_si256( _mm256_add_epi32( pz, one_i ), z_mask );
+
+        const int32_t* hash = tables.randtab;
+        const int32_t* grad = tables.grad_idx;
+        const __m256i r0 = Lookup8( hash, x0, seed );
+        const __m256i r1 = Lookup8( hash, x1, seed );
+        const __m256i r00 = Lookup8( hash, r0, y0 );
+        const __m256i r01 = Lookup8( hash, r0, y1 );
+        const __m256i r10 = Lookup8( hash, r1, y0 );
+        const __m256i r11 = Lookup8( hash, r1, y1 );
+
+        const __m256 one = _mm256_set1_ps( 1.0f );
+        const __m256 xm = _mm256_sub_ps( x, one );
+        const __m256 ym = _mm256_sub_ps( y, one );
+        const __m256 zm = _mm256_sub_ps( z, one );
+
+        const __m256 n00 = Lerp8( Grad8( Lookup8( grad, r00, z0 ), x, y, z ), Grad8( Lookup8( grad, r00, z1 ), x, y, zm ), w );
+        const __m256 n01 = Lerp8( Grad8( Lookup8( grad, r01, z0 ), x, ym, z ), Grad8( Lookup8( grad, r01, z1 ), x, ym, zm ), w );
+        const __m256 n10 = Lerp8( Grad8( Lookup8( grad, r10, z0 ), xm, y, z ), Grad8( Lookup8( grad, r10, z1 ), xm, y, zm ), w );
+        const __m256 n11 = Lerp8( Grad8( Lookup8( grad, r11, z0 ), xm, ym, z ), Grad8( Lookup8( grad, r11, z1 ), xm, ym, zm ), w );
+
+        return Lerp8( Lerp8( n00, n01, v ), Lerp8( n10, n11, v ), u );
+    }
+
+    PERLIN_TARGET( "avx2" ) size_t NoiseAVX2( const float* x, const float* y, const float* z, float* out, const size_t count, const Wrap& wrap )
+    {
+        const WideTables& tables = GetWideTables();
+        size_t i = 0;
+        for( ; i + 8 <= count; i += 8 )
+        {
+            _mm256_storeu_ps( out + i, Noise8( _mm256_loadu_ps( x + i ), _mm256_loadu_ps( y + i ), _mm256_loadu_ps( z + i ), wrap, tables ) );
+        }
+        return i;
+    }
+
+    PERLIN_TARGET( "avx2" ) size_t RowAVX2( const float x0, const float dx, const float y, const float z0, const float dz,
+                                            float* out, const size_t count, const Wrap& wrap )
+    {
+        const WideTables& tables = GetWideTables();
+        const __m256 step = _mm256_setr_ps( 0, 1, 2, 3, 4, 5, 6, 7 );
+        const __m256 y8 = _mm256_set1_ps( y );
+        size_t i = 0;
+        for( ; i + 8 <= count; i += 8 )
+        {
+            // Same float( i ) * d + start as the scalar tail, lane by lane.
+            const __m256 index = _mm256_add_ps( _mm256_set1_ps( static_cast<float>( i ) ), step );
+            const __m256 x = _mm256_add_ps( _mm256_set1_ps( x0 ), _mm256_mul_ps( index, _mm256_set1_ps( dx ) ) );
+            const __m256 z = _mm256_add_ps( _mm256_set1_ps( z0 ), _mm256_mul_ps( index, _mm256_set1_ps( dz ) ) );
+            _mm256_storeu_ps( out + i, Noise8( x, y8, z, wrap, tables ) );
+        }
+        return i;
+    }
+
+    PERLIN_TARGET( "avx2" ) size_t ZCellsAVX2( const ZCellRow& cells, const float z0, const float dz, float* out, const size_t count )
+    {
+        const __m256 step = _mm256_setr_ps( 0, 1, 2, 3, 4, 5, 6, 7 );
+        const __m256 one = _mm256_set1_ps( 1.0f );
+        size_t i = 0;
+        for( ; i + 8 <= count; i += 8 )
+        {
+            const __m256 index = _mm256_add_ps( _mm256_set1_ps( static_cast<float>( i ) ), step );
+            const __m256 z = _mm256_add_ps( _mm256_set1_ps( z0 ), _mm256_mul_ps( index, _mm256_set1_ps( dz ) ) );
+            const __m256 fz = _mm256_sub_ps( z, _mm256_cvtepi32_ps( _mm256_loadu_si256( reinterpret_cast<const __m256i*>( cells.cell + i ) ) ) );
+            const __m256 lower = _mm256_add_ps( _mm256_loadu_ps( cells.lower + i ), _mm256_mul_ps( _mm256_loadu_ps( cells.lower_dz + i ), fz ) );
+            const __m256 upper = _mm256_add_ps( _mm256_loadu_ps( cells.upper + i ),
+                                                _mm256_mul_ps( _mm256_loadu_ps( cells.upper_dz + i ), _mm256_sub_ps( fz, one ) ) );
+            _mm256_storeu_ps( out + i, Lerp8( lower, upper, Ease8( fz ) ) );
+        }
+        return i;
+    }
+#endif
+
+    // Batches of SSE2 or AVX2, the rest (and non-x86) scalar.  Returns how many were done.
+    size_t NoiseSimd( const float* x, const float* y, const float* z, float* out, const size_t count, const Wrap& wrap, const SimdLevel level )
+    {
+        size_t i = 0;
+#if PERLIN_X64
+        if( level == SimdLevel::AVX2 )
+        {
+            i = NoiseAVX2( x, y, z, out, count, wrap );
+        }
+        if( level != SimdLevel::Scalar )
+        {
+            for( ; i + 4 <= count; i += 4 )
+            {
+                _mm_storeu_ps( out + i, Noise4( _mm_loadu_ps( x + i ), _mm_loadu_ps( y + i ), _mm_loadu_ps( z + i ), wrap ) );
+            }
+        }
+#else
+        (void)x; (void)y; (void)z; (void)out; (void)count; (void)wrap; (void)level;
+#endif
+        return i;
+    }
+}
+
+SimdLevel BestSimdLevel()
+{
+#if PERLIN_X64
+    static const SimdLevel best = []()
+    {
+#if defined( _MSC_VER ) && !defined( __clang__ )
+        // AVX2 needs the OS to save the YMM registers as well as CPU support.
+        int info[ 4 ];
+        __cpuid( info, 1 );
+        if( !( info[ 2 ] & ( 1 << 27 ) ) || ( _xgetbv( 0 ) & 0x6 ) != 0x6 )
+        {
+            return SimdLevel::SSE2;
+        }
+        __cpuidex( info, 7, 0 );
+        return ( info[ 1 ] & ( 1 << 5 ) ) ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports( "avx2" ) ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#endif
+    }();
+    return best;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* SimdLevelName( const SimdLevel level )
+{
+    switch( level )
+    {
+        case SimdLevel::AVX2: return "AVX2 x8";
+        case SimdLevel::SSE2: return "SSE2 x4";
+        default:              return "scalar";
+    }
+}
+
+void Noise3( const float* x, const float* y, const float* z, float* out, const size_t count,
+             const int x_wrap, const int y_wrap, const int z_wrap, const int seed, const SimdLevel level )
+{
+    const Wrap wrap = MakeWrap( x_wrap, y_wrap, z_wrap, seed );
+    const size_t done = NoiseSimd( x, y, z, out, count, wrap, level );
+    NoiseScalar( x + done, y + done, z + done, out + done, count - done, x_wrap, y_wrap, z_wrap, wrap );
+}
+
+void Noise3Row( const float x0, const float dx, const float y, const float z0, const float dz, float* out, const size_t count,
+                const int seed, const SimdLevel level )
+{
+    const Wrap wrap = MakeWrap( 0, 0, 0, seed );
+    size_t i = 0;
+#if PERLIN_X64
+    if( level == SimdLevel::AVX2 )
+    {
+        i = RowAVX2( x0, dx, y, z0, dz, out, count, wrap );
+    }
+    if( level != SimdLevel::Scalar )
+    {
+        const __m128 step = _mm_setr_ps( 0, 1, 2, 3 );
+        for( ; i + 4 <= count; i += 4 )
+        {
+            const __m128 index = _mm_add_ps( _mm_set1_ps( static_cast<float>( i ) ), step );
+            const __m128 x = _mm_add_ps( _mm_set1_ps( x0 ), _mm_mul_ps( index, _mm_set1_ps( dx ) ) );
+            const __m128 z = _mm_add_ps( _mm_set1_ps( z0 ), _mm_mul_ps( index, _mm_set1_ps( dz ) ) );
+            _mm_storeu_ps( out + i, Noise4( x, _mm_set1_ps( y ), z, wrap ) );
+        }
+    }
+#else
+    (void)level;
+#endif
+    for( ; i < count; ++i )
+    {
+        const float index = static_cast<float>( i );
+        out[ i ] = stb_perlin_noise3_internal( x0 + index * dx, y, z0 + index * dz, 0, 0, 0, static_cast<unsigned char>( wrap.seed ) );
+    }
+}
+
+void Noise3Tile( const float x0, const float dx, const float y0, const float dy, const float z0, const float dz_dx, const float dz_dy,
+                 const size_t width, const size_t height, float* out, const size_t stride, const int seed, const SimdLevel level )
+{
+    for( size_t j = 0; j < height; ++j )
+    {
+        const float row = static_cast<float>( j );
+        Noise3Row( x0, dx, y0 + row * dy, z0 + row * dz_dy, dz_dx, out + j * stride, width, seed, level );
+    }
+}
+
+ZCell MakeZCell( const float x, const float y, const float z, const int seed )
+{
+    const int px = ZCellFloor( x );
+    const int py = ZCellFloor( y );
+    const int pz = ZCellFloor( z );
+    const float fx = x - px, u = stb__perlin_ease( fx );
+    const float fy = y - py, v = stb__perlin_ease( fy );
+
+    // The same corner hashing as stb_perlin_noise3_internal.
+    const unsigned char s = static_cast<unsigned char>( seed );
+    const int x0 = px & 255, x1 = ( px + 1 ) & 255;
+    const int y0 = py & 255, y1 = ( py + 1 ) & 255;
+    const int z0 = pz & 255, z1 = ( pz + 1 ) & 255;
+    const int r0 = stb__perlin_randtab[ x0 + s ];
+    const int r1 = stb__perlin_randtab[ x1 + s ];
+    const int corners[ 4 ] = { stb__perlin_randtab[ r0 + y0 ], stb__perlin_randtab[ r0 + y1 ],
+                               stb__perlin_randtab[ r1 + y0 ], stb__perlin_randtab[ r1 + y1 ] };
+
+    // Per corner, gradient . ( x offset, y offset ) and the gradient's z, on each face.
+    float flat[ 2 ][ 4 ], slope[ 2 ][ 4 ];
+    for( int c = 0; c < 4; ++c )
+    {
+        const float cx = ( c & 2 ) ? fx - 1 : fx;
+        const float cy = ( c & 1 ) ? fy - 1 : fy;
+        for( int face = 0; face < 2; ++face )
+        {
+            const int g = stb__perlin_randtab_grad_idx[ corners[ c ] + ( face ? z1 : z0 ) ];
+            flat[ face ][ c ] = stb__perlin_grad( g, cx, cy, 0 );
+            slope[ face ][ c ] = stb__perlin_grad( g, 0, 0, 1 );
+        }
+    }
+
+    auto bilerp = [u, v]( const float* n )
+    {
+        return stb__perlin_lerp( stb__perlin_lerp( n[ 0 ], n[ 1 ], v ), stb__perlin_lerp( n[ 2 ], n[ 3 ], v ), u );
+    };
+    return ZCell{ bilerp( flat[ 0 ] ), bilerp( slope[ 0 ] ), bilerp( flat[ 1 ] ), bilerp( slope[ 1 ] ), pz };
+}
+
+void EvaluateZCellRow( const ZCellRow& cells, const float z0, const float dz, float* out, const size_t count, const SimdLevel level )
+{
+    size_t i = 0;
+#if PERLIN_X64
+    if( level == SimdLevel::AVX2 )
+    {
+        i = ZCellsAVX2( cells, z0, dz, out, count );
+    }
+    if( level != SimdLevel::Scalar )
+    {
+        const __m128 step = _mm_setr_ps( 0, 1, 2, 3 );
+        const __m128 one = _mm_set1_ps( 1.0f );
+        for( ; i + 4 <= count; i += 4 )
+        {
+            const __m128 index = _mm_add_ps( _mm_set1_ps( static_cast<float>( i ) ), step );
+            const __m128 z = _mm_add_ps( _mm_set1_ps( z0 ), _mm_mul_ps( index, _mm_set1_ps( dz ) ) );
+            const __m128 fz = _mm_sub_ps( z, _mm_cvtepi32_ps( _mm_loadu_si128( reinterpret_cast<const __m128i*>( cells.cell + i ) ) ) );
+            const __m128 lower = _mm_add_ps( _mm_loadu_ps( cells.lower + i ), _mm_mul_ps( _mm_loadu_ps( cells.lower_dz + i ), fz ) );
+            const __m128 upper = _mm_add_ps( _mm_loadu_ps( cells.upper + i ), _mm_mul_ps( _mm_loadu_ps( cells.upper_dz + i ), _mm_sub_ps( fz, one ) ) );
+            _mm_storeu_ps( out + i, Lerp4( lower, upper, Ease4( fz ) ) );
+        }
+    }
+#else
+    (void)level;
+#endif
+    for( ; i < count; ++i )
+    {
+        const ZCell cell = { cells.lower[ i ], cells.lower_dz[ i ], cells.upper[ i ], cells.upper_dz[ i ], cells.cell[ i ] };
+        out[ i ] = EvaluateZCell( cell, z0 + static_cast<float>( i ) * dz );
+    }
+}
+
+}
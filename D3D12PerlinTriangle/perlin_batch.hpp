@@ -0,0 +1,90 @@
+#pragma once
+// Batch Perlin noise: stb_perlin_noise3 for many points per call.
+//
+// Same noise as stb_perlin.h (same permutation and gradient tables, same arithmetic in
+// the same order), evaluated 4 points at a time with SSE2 or 8 with AVX2.  The SIMD
+// level is picked once at runtime from what the CPU supports; other CPUs get a loop
+// over the stb function.  No D3D or Windows dependency, so tools can use it too.
+//
+// perlin_batch.cpp is also where stb_perlin's implementation is compiled
+// (STB_PERLIN_IMPLEMENTATION), since it needs stb's tables.
+
+#include <cstddef>
+
+namespace perlin_batch
+{
+    enum class SimdLevel
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+    };
+
+    // The best level this CPU can run.
+    SimdLevel BestSimdLevel();
+    const char* SimdLevelName( SimdLevel level );
+
+    // out[ i ] = stb_perlin_noise3_seed( x[ i ], y[ i ], z[ i ], x_wrap, y_wrap, z_wrap, seed ).
+    // Wraps are powers of 2 or 0, as for stb.
+    void Noise3( const float* x, const float* y, const float* z, float* out, size_t count,
+                 int x_wrap = 0, int y_wrap = 0, int z_wrap = 0, int seed = 0, SimdLevel level = BestSimdLevel() );
+
+    // One row: point i is ( x0 + i * dx, y, z0 + i * dz ).
+    void Noise3Row( float x0, float dx, float y, float z0, float dz, float* out, size_t count,
+                    int seed = 0, SimdLevel level = BestSimdLevel() );
+
+    // A width x height tile, rows stride floats apart: pixel ( i, j ) is
+    // ( x0 + i * dx, y0 + j * dy, z0 + i * dz_dx + j * dz_dy ).
+    void Noise3Tile( float x0, float dx, float y0, float dy, float z0, float dz_dx, float dz_dy,
+                     size_t width, size_t height, float* out, size_t stride,
+                     int seed = 0, SimdLevel level = BestSimdLevel() );
+
+    // Noise along z at a fixed x, y.  Within one lattice cell (cell <= z < cell + 1)
+    // the x and y interpolation doesn't depend on z, so noise3 reduces to a line per z
+    // face, blended by the ease of the z fraction.  Building one costs about a noise
+    // sample; evaluating it is a few multiply-adds, exact to float rounding, as long
+    // as z stays in the cell.  For animating z over a fixed image.
+    struct ZCell
+    {
+        float lower;        // z = cell face:     lower + lower_dz * fz
+        float lower_dz;
+        float upper;        // z = cell + 1 face: upper + upper_dz * ( fz - 1 )
+        float upper_dz;
+        int   cell;
+    };
+
+    // The cell holding z, at x, y.  No wraps, like Noise3Row.
+    ZCell MakeZCell( float x, float y, float z, int seed = 0 );
+
+    inline int ZCellFloor( const float z )
+    {
+        // stb's floor, so cells split where stb's do.
+        const int truncated = static_cast<int>( z );
+        return ( z < truncated ) ? truncated - 1 : truncated;
+    }
+
+    // stb_perlin_noise3_seed( x, y, z ) for the x, y and seed cell was made with, and z
+    // in [ cell.cell, cell.cell + 1 ).
+    inline float EvaluateZCell( const ZCell& cell, const float z )
+    {
+        const float fz = z - static_cast<float>( cell.cell );
+        const float w = ( ( fz * 6 - 15 ) * fz + 10 ) * fz * fz * fz;
+        const float lower = cell.lower + cell.lower_dz * fz;
+        const float upper = cell.upper + cell.upper_dz * ( fz - 1 );
+        return lower + ( upper - lower ) * w;
+    }
+
+    // ZCells kept as separate arrays, for EvaluateZCellRow.
+    struct ZCellRow
+    {
+        const float* lower;
+        const float* lower_dz;
+        const float* upper;
+        const float* upper_dz;
+        const int*   cell;
+    };
+
+    // out[ i ] = EvaluateZCell( cell i, z0 + i * dz ); every z must be in its cell.
+    void EvaluateZCellRow( const ZCellRow& cells, float z0, float dz, float* out, size_t count,
+                           SimdLevel level = BestSimdLevel() );
+}
@@ -0,0 +1,439 @@
+// Command line tool for the portable noise code, no D3D needed.
+//
+// Usage: PerlinNoiseTool verify        check the batch noise against stb_perlin_noise3,
+//                                      and the textures against per-pixel versions
+//        PerlinNoiseTool bench [size]  time a size x size tile at each SIMD level
+//        PerlinNoiseTool bake <pattern> <size> <file.png|file.ppm> [threads] [octaves]
+//                                      generate a size x size texture and save it
+//        PerlinNoiseTool animate [size] [frames] [threads]
+//                                      time incremental frames of the animated texture
+//
+// [threads] is 0 (the default) for one per core, fewer for small textures; the
+// textures run on the shared pool, which has one thread per core, so more than that
+// is one per core too.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "perlin_batch.hpp"
+#include "stb_perlin.h"
+#include "animated_texture.hpp"
+#include "texture_generator.hpp"
+
+using perlin_batch::SimdLevel;
+using texture_gen::Pattern;
+using texture_gen::TextureSettings;
+
+// Batch and scalar should agree to the last bit, apart from the sign of a zero; this
+// leaves room for a compiler contracting a multiply-add somewhere.
+static const float TOLERANCE = 1e-6f;
+static const int DEFAULT_BENCH_SIZE = 2048;
+static const int REP_COUNT = 5;
+// Textures are bytes; the batch rows step their coordinates differently from the
+// per-pixel reference, which can tip a value across a rounding boundary.
+static const int BYTE_TOLERANCE = 1;
+// ZCells regroup noise3's arithmetic, so they only agree to float rounding.
+static const float ZCELL_TOLERANCE = 1e-5f;
+static const int DEFAULT_ANIMATE_SIZE = 2048;
+static const int DEFAULT_ANIMATE_FRAMES = 120;
+// verify's multithreaded runs use a pool this big, however many cores there are.
+static const int VERIFY_THREADS = 4;
+// z units per second; at 60 fps a pixel changes cell about once every 120 frames.
+static const float ANIMATE_SPEED = 0.5f;
+static const float FRAME_RATE = 60.0f;
+
+static std::vector<SimdLevel> AvailableLevels()
+{
+    std::vector<SimdLevel> levels = { SimdLevel::Scalar };
+    if( perlin_batch::BestSimdLevel() != SimdLevel::Scalar )
+    {
+        levels.push_back( SimdLevel::SSE2 );
+    }
+    if( perlin_batch::BestSimdLevel() == SimdLevel::AVX2 )
+    {
+        levels.push_back( SimdLevel::AVX2 );
+    }
+    return levels;
+}
+
+static bool Verify()
+{
+    // Random points, negative ones included (the floor has to round down), spread past
+    // 256 (the lattice wraps there), in a count that leaves a scalar tail.
+    const size_t count = 100003;
+    std::vector<float> x( count ), y( count ), z( count ), batch( count );
+    uint32_t random = 1;
+    auto next = [&random]()
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return ( random / 4294967296.0f ) * 700.0f - 350.0f;
+    };
+    for( size_t i = 0; i < count; ++i )
+    {
+        x[ i ] = next();
+        y[ i ] = next();
+        z[ i ] = next();
+    }
+
+    struct Case { int x_wrap, y_wrap, z_wrap, seed; };
+    const Case cases[] = { { 0, 0, 0, 0 }, { 0, 0, 0, 1 }, { 0, 0, 0, 200 }, { 16, 8, 4, 0 }, { 256, 2, 64, 7 } };
+
+    bool ok = true;
+    for( const SimdLevel level : AvailableLevels() )
+    {
+        float max_error = 0.0f;
+        for( const Case& c : cases )
+        {
+            perlin_batch::Noise3( x.data(), y.data(), z.data(), batch.data(), count, c.x_wrap, c.y_wrap, c.z_wrap, c.seed, level );
+            for( size_t i = 0; i < count; ++i )
+            {
+                const float expected = stb_perlin_noise3_seed( x[ i ], y[ i ], z[ i ], c.x_wrap, c.y_wrap, c.z_wrap, c.seed );
+                max_error = std::max( max_error, std::fabs( batch[ i ] - expected ) );
+            }
+        }
+
+        // Rows compute their own coordinates; the same formula on the scalar side.
+        const float x0 = -3.3f, dx = 1.0f / 61.0f, row_y = 2.7f, z0 = -1.1f, dz = 1.0f / 122.0f;
+        perlin_batch::Noise3Row( x0, dx, row_y, z0, dz, batch.data(), count, 0, level );
+        for( size_t i = 0; i < count; ++i )
+        {
+            const float index = static_cast<float>( i );
+            const float expected = stb_perlin_noise3( x0 + index * dx, row_y, z0 + index * dz, 0, 0, 0 );
+            max_error = std::max( max_error, std::fabs( batch[ i ] - expected ) );
+        }
+
+        const bool level_ok = max_error <= TOLERANCE;
+        printf( "%-8s max error %g %s\n", perlin_batch::SimdLevelName( level ), max_error, level_ok ? "ok" : "FAILED" );
+        ok = ok && level_ok;
+    }
+    return ok;
+}
+
+// The app's original per-pixel generators, generalized to the fractal patterns.
+static uint8_t ReferencePixel( const TextureSettings& settings, const size_t column, const size_t row )
+{
+    if( settings.pattern == Pattern::Checkerboard )
+    {
+        const size_t cell = std::max<size_t>( 1, settings.width >> 3 );
+        return ( ( column / cell ) % 2 == ( row / cell ) % 2 ) ? 0x00 : 0xff;
+    }
+
+    const float x = column * settings.scale / settings.width;
+    const float y = row * settings.scale / settings.height;
+    const float z = settings.z + ( x + y ) / 2.0f;
+
+    float amplitude_sum = 0.0f, amplitude = ( settings.pattern == Pattern::Ridge ) ? 0.5f : 1.0f;
+    for( int octave = 0; octave < settings.octaves; ++octave, amplitude *= settings.gain )
+    {
+        amplitude_sum += amplitude;
+    }
+
+    float value;
+    switch( settings.pattern )
+    {
+        case Pattern::Fbm:
+            value = ( stb_perlin_fbm_noise3( x, y, z, settings.lacunarity, settings.gain, settings.octaves ) / amplitude_sum + 1.0f ) * 127.5f;
+            break;
+        case Pattern::Turbulence:
+            value = stb_perlin_turbulence_noise3( x, y, z, settings.lacunarity, settings.gain, settings.octaves ) / amplitude_sum * 255.0f;
+            break;
+        case Pattern::Ridge:
+            value = stb_perlin_ridge_noise3( x, y, z, settings.lacunarity, settings.gain, settings.offset, settings.octaves )
+                  / ( amplitude_sum * std::pow( settings.offset, 4.0f ) ) * 255.0f;
+            break;
+        default:
+            value = ( stb_perlin_noise3( x, y, z, 0, 0, 0 ) + 1 ) * 128.0f;
+            break;
+    }
+    return static_cast<uint8_t>( std::min( 255.0f, std::max( 0.0f, value ) ) );
+}
+
+static bool VerifyTextures()
+{
+    struct Case { const char* pattern; size_t width, height; float scale, z; size_t tile_size; };
+    const Case cases[] =
+    {
+        { "checkerboard", 256, 256, 1.0f,  0.0f, 64 },
+        { "checkerboard", 1000, 333, 1.0f, 0.0f, 64 },  // cells and tiles that don't divide the texture
+        { "perlin",       256, 256, 1.0f,  0.0f, 64 },
+        { "perlin",       517, 300, 13.0f, 2.5f, 48 },
+        { "fbm",          300, 200, 4.0f,  0.0f, 64 },
+        { "ridge",        300, 200, 4.0f,  1.0f, 64 },
+        { "turbulence",   300, 200, 4.0f,  0.0f, 37 },
+    };
+
+    texture_gen::WorkerPool pool( VERIFY_THREADS );
+    bool ok = true;
+    for( const Case& c : cases )
+    {
+        TextureSettings settings;
+        texture_gen::ParsePattern( c.pattern, settings.pattern );
+        settings.width = c.width;
+        settings.height = c.height;
+        settings.scale = c.scale;
+        settings.z = c.z;
+        settings.tile_size = c.tile_size;
+
+        settings.threads = 1;
+        const std::vector<uint8_t> serial = texture_gen::GenerateRGBA( settings );
+        settings.threads = VERIFY_THREADS;
+        const bool same = texture_gen::GenerateRGBA( settings, pool ) == serial;
+
+        int max_error = 0;
+        for( size_t row = 0; row < c.height; ++row )
+        {
+            for( size_t column = 0; column < c.width; ++column )
+            {
+                const uint8_t* pixel = &serial[ ( row * c.width + column ) * texture_gen::BYTES_PER_PIXEL ];
+                const int expected = ReferencePixel( settings, column, row );
+                for( int channel = 0; channel < 3; ++channel )
+                {
+                    max_error = std::max( max_error, std::abs( pixel[ channel ] - expected ) );
+                }
+                max_error = std::max( max_error, std::abs( pixel[ 3 ] - 0xff ) );
+            }
+        }
+
+        // The checkerboard is exact.
+        const int tolerance = ( settings.pattern == Pattern::Checkerboard ) ? 0 : BYTE_TOLERANCE;
+        const bool case_ok = same && max_error <= tolerance;
+        printf( "%-12s %4zux%-4zu max error %d, 1 vs %d threads %s %s\n", c.pattern, c.width, c.height, max_error,
+                VERIFY_THREADS, same ? "identical" : "DIFFER", case_ok ? "ok" : "FAILED" );
+        ok = ok && case_ok;
+    }
+
+    // Textures generated from inside the pool's own jobs run inline instead of waiting
+    // on the pool.
+    TextureSettings settings;
+    settings.pattern = Pattern::Fbm;
+    const std::vector<uint8_t> expected = texture_gen::GenerateRGBA( settings, pool );
+    std::vector<std::vector<uint8_t>> nested( VERIFY_THREADS );
+    pool.Run( nested.size(), VERIFY_THREADS, [&]( const size_t index ) { nested[ index ] = texture_gen::GenerateRGBA( settings, pool ); } );
+    const bool nested_ok = std::all_of( nested.begin(), nested.end(), [&]( const std::vector<uint8_t>& rgba ) { return rgba == expected; } );
+    printf( "nested       %4zux%-4zu generated in pool jobs %s\n", settings.width, settings.height, nested_ok ? "ok" : "FAILED" );
+    return ok && nested_ok;
+}
+
+static bool VerifyAnimation()
+{
+    // ZCells against stb, at z values spread through the cell they were made for.
+    uint32_t random = 7;
+    auto next = [&random]()
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return ( random / 4294967296.0f ) * 600.0f - 300.0f;
+    };
+    float max_error = 0.0f;
+    for( int i = 0; i < 20000; ++i )
+    {
+        const float x = next(), y = next(), z = next();
+        const perlin_batch::ZCell cell = perlin_batch::MakeZCell( x, y, z );
+        for( const float fraction : { 0.0f, 0.25f, 0.5f, 0.999f } )
+        {
+            const float cell_z = static_cast<float>( cell.cell ) + fraction;
+            const float error = std::fabs( perlin_batch::EvaluateZCell( cell, cell_z ) - stb_perlin_noise3( x, y, cell_z, 0, 0, 0 ) );
+            max_error = std::max( max_error, error );
+        }
+    }
+    const bool cells_ok = max_error <= ZCELL_TOLERANCE;
+    printf( "z cells      max error %g %s\n", max_error, cells_ok ? "ok" : "FAILED" );
+
+    // Frames against full textures, stepping forwards (a few cells at once too) and back,
+    // into rows padded the way an upload buffer's are.
+    TextureSettings settings;
+    settings.width = 300;
+    settings.height = 200;
+    settings.scale = 5.0f;
+    settings.threads = 3;
+    texture_gen::WorkerPool pool( VERIFY_THREADS );
+    texture_gen::AnimatedTexture animated( settings, pool );
+
+    const size_t row_pitch = settings.width * texture_gen::BYTES_PER_PIXEL + 64;
+    std::vector<uint8_t> frame( row_pitch * settings.height );
+    int max_byte_error = 0;
+    for( const float z : { 0.0f, 0.01f, 0.3f, 1.7f, 4.2f, -2.2f, 0.5f } )
+    {
+        animated.Render( z, frame.data(), row_pitch );
+        settings.z = z;
+        const std::vector<uint8_t> expected = texture_gen::GenerateRGBA( settings, pool );
+        for( size_t row = 0; row < settings.height; ++row )
+        {
+            for( size_t i = 0; i < settings.width * texture_gen::BYTES_PER_PIXEL; ++i )
+            {
+                const int error = std::abs( frame[ row * row_pitch + i ] - expected[ row * settings.width * texture_gen::BYTES_PER_PIXEL + i ] );
+                max_byte_error = std::max( max_byte_error, error );
+            }
+        }
+    }
+    const bool frames_ok = max_byte_error <= BYTE_TOLERANCE;
+    printf( "animation     300x200  max error %d %s\n", max_byte_error, frames_ok ? "ok" : "FAILED" );
+    return cells_ok && frames_ok;
+}
+
+// The texture's noise: x and y across [0, 1), z = ( x + y ) / 2.
+static void Bench( const int size )
+{
+    std::vector<float> noise( static_cast<size_t>( size ) * size );
+    const float step = 1.0f / size;
+    const double samples = double( size ) * size;
+    printf( "%dx%d tile, best of %d\n", size, size, REP_COUNT );
+
+    double stb_seconds = 1e30;
+    for( int rep = 0; rep < REP_COUNT; ++rep )
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for( int j = 0; j < size; ++j )
+        {
+            for( int i = 0; i < size; ++i )
+            {
+                const float x = i * step, y = j * step;
+                noise[ static_cast<size_t>( j ) * size + i ] = stb_perlin_noise3( x, y, ( x + y ) / 2.0f, 0, 0, 0 );
+            }
+        }
+        stb_seconds = std::min( stb_seconds, std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
+    }
+    printf( "%-22s %8.1f M samples/s\n", "stb_perlin_noise3", samples / stb_seconds / 1e6 );
+
+    for( const SimdLevel level : AvailableLevels() )
+    {
+        double seconds = 1e30;
+        for( int rep = 0; rep < REP_COUNT; ++rep )
+        {
+            const auto start = std::chrono::steady_clock::now();
+            perlin_batch::Noise3Tile( 0.0f, step, 0.0f, step, 0.0f, step / 2.0f, step / 2.0f, size, size, noise.data(), size, 0, level );
+            seconds = std::min( seconds, std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() );
+        }
+        char label[ 32 ];
+        snprintf( label, sizeof( label ), "Noise3Tile, %s", perlin_batch::SimdLevelName( level ) );
+        printf( "%-22s %8.1f M samples/s  %.2fx\n", label, samples / seconds / 1e6, stb_seconds / seconds );
+    }
+}
+
+static bool Bake( const char* pattern, const size_t size, const char* path, const int threads, const int octaves )
+{
+    TextureSettings settings;
+    if( !texture_gen::ParsePattern( pattern, settings.pattern ) )
+    {
+        printf( "Unknown pattern %s\n", pattern );
+        return false;
+    }
+    settings.width = size;
+    settings.height = size;
+    settings.threads = threads;
+    if( octaves > 0 )
+    {
+        settings.octaves = octaves;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<uint8_t> rgba = texture_gen::GenerateRGBA( settings );
+    const double generate_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    const auto write_start = std::chrono::steady_clock::now();
+    if( !texture_gen::WriteImage( path, rgba.data(), size, size ) )
+    {
+        printf( "Couldn't write %s (the extension must be .png or .ppm)\n", path );
+        return false;
+    }
+    const double write_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - write_start ).count();
+
+    printf( "%s %zux%zu: generated in %.3f s (%.1f M pixels/s), written in %.3f s\n", pattern, size, size, generate_seconds,
+            double( size ) * size / generate_seconds / 1e6, write_seconds );
+    return true;
+}
+
+// Frames at 60 fps worth of z steps, alternating between two buffers like the app's
+// upload buffers, against generating each frame from scratch.
+static void Animate( const size_t size, const int frames, const int threads )
+{
+    TextureSettings settings;
+    settings.width = size;
+    settings.height = size;
+    settings.threads = threads;
+    texture_gen::AnimatedTexture animated( settings );
+
+    const size_t row_pitch = size * texture_gen::BYTES_PER_PIXEL;
+    std::vector<uint8_t> buffers[ 2 ] = { std::vector<uint8_t>( row_pitch * size ), std::vector<uint8_t>( row_pitch * size ) };
+
+    auto start = std::chrono::steady_clock::now();
+    animated.Render( 0.0f, buffers[ 0 ].data(), row_pitch );
+    const double first_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    size_t rebuilt = 0;
+    start = std::chrono::steady_clock::now();
+    for( int frame = 1; frame <= frames; ++frame )
+    {
+        rebuilt += animated.Render( frame * ANIMATE_SPEED / FRAME_RATE, buffers[ frame % 2 ].data(), row_pitch );
+    }
+    const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count() / frames;
+
+    start = std::chrono::steady_clock::now();
+    settings.z = ANIMATE_SPEED / FRAME_RATE;
+    texture_gen::GenerateRGBA( settings );
+    const double full_seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    printf( "%zux%zu, %d frames\n", size, size, frames );
+    printf( "first frame (builds every cell) %8.2f ms\n", first_seconds * 1e3 );
+    printf( "incremental frame               %8.2f ms  %6.1f fps  %.2f%% of pixels rebuilt\n", seconds * 1e3, 1.0 / seconds,
+            100.0 * rebuilt / ( double( size ) * size * frames ) );
+    printf( "GenerateRGBA per frame          %8.2f ms  %6.1f fps\n", full_seconds * 1e3, 1.0 / full_seconds );
+}
+
+int main( int argc, char** argv )
+{
+    if( argc > 1 && !strcmp( argv[ 1 ], "verify" ) )
+    {
+        const bool noise_ok = Verify();
+        const bool textures_ok = VerifyTextures();
+        const bool animation_ok = VerifyAnimation();
+        return ( noise_ok && textures_ok && animation_ok ) ? 0 : 1;
+    }
+    if( argc > 1 && !strcmp( argv[ 1 ], "animate" ) )
+    {
+        const long size = ( argc > 2 ) ? atol( argv[ 2 ] ) : DEFAULT_ANIMATE_SIZE;
+        const int frames = ( argc > 3 ) ? atoi( argv[ 3 ] ) : DEFAULT_ANIMATE_FRAMES;
+        const int threads = ( argc > 4 ) ? atoi( argv[ 4 ] ) : 0;
+        if( size > 0 && frames > 0 )
+        {
+            Animate( static_cast<size_t>( size ), frames, threads );
+            return 0;
+        }
+    }
+    if( argc > 4 && !strcmp( argv[ 1 ], "bake" ) )
+    {
+        const long size = atol( argv[ 3 ] );
+        const int threads = ( argc > 5 ) ? atoi( argv[ 5 ] ) : 0;
+        const int octaves = ( argc > 6 ) ? atoi( argv[ 6 ] ) : 0;
+        if( size > 0 )
+        {
+            return Bake( argv[ 2 ], static_cast<size_t>( size ), argv[ 4 ], threads, octaves ) ? 0 : 1;
+        }
+    }
+    if( argc > 1 && !strcmp( argv[ 1 ], "bench" ) )
+    {
+        const int size = ( argc > 2 ) ? atoi( argv[ 2 ] ) : DEFAULT_BENCH_SIZE;
+        if( size > 0 )
+        {
+            Bench( size );
+            return 0;
+        }
+    }
+
+    printf( "Usage: PerlinNoiseTool verify\n" );
+    printf( "       PerlinNoiseTool bench [size]\n" );
+    printf( "       PerlinNoiseTool bake <pattern> <size> <file.png|file.ppm> [threads] [octaves]\n" );
+    printf( "       PerlinNoiseTool animate [size] [frames] [threads]\n" );
+    printf( "       patterns: checkerboard, perlin, fbm, ridge, turbulence\n" );
+    printf( "       threads: 0 (default) for one per core; at most one per core\n" );
+    return 1;
+}
@@ -11,5 +11,4 @@
 
 #include "stdafx.h"
 
-#define STB_PERLIN_IMPLEMENTATION
-#include "stb_perlin.h"
\ No newline at end of file
+// stb_perlin's implementation is compiled in perlin_batch.cpp.
\ No newline at end of file
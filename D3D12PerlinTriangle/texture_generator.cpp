@@ -0,0 +1,431 @@
+#include "texture_generator.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "perlin_batch.hpp"
+#include "worker_pool.hpp"
+
+namespace texture_gen
+{
+
+namespace
+{
+    // Scratch for one thread: a tile row of noise, and the octave sum.
+    struct RowBuffers
+    {
+        std::vector<float> noise;
+        std::vector<float> sum;
+    };
+
+    inline uint8_t ToByte( const float value )
+    {
+        return static_cast<uint8_t>( std::min( 255.0f, std::max( 0.0f, value ) ) );
+    }
+
+    inline void StoreGray( uint8_t* pixel, const uint8_t gray )
+    {
+        pixel[ 0 ] = gray;  // R
+        pixel[ 1 ] = gray;  // G
+        pixel[ 2 ] = gray;  // B
+        pixel[ 3 ] = 0xff;  // A
+    }
+
+    // The app's checkerboard: cells an eighth of the width on a side, black where the
+    // cell column and row have the same parity.  Cell numbers are stepped rather than
+    // divided out per pixel.
+    void CheckerboardTile( const TextureSettings& settings, const size_t left, const size_t top, const size_t width, const size_t height, uint8_t* pixels )
+    {
+        const size_t cell = std::max<size_t>( 1, settings.width >> 3 );
+        for( size_t y = top; y < top + height; ++y )
+        {
+            const size_t row_parity = ( y / cell ) & 1;
+            size_t column_parity = ( left / cell ) & 1;
+            size_t in_cell = left % cell;
+
+            uint8_t* pixel = pixels + ( y * settings.width + left ) * BYTES_PER_PIXEL;
+            for( size_t x = 0; x < width; ++x, pixel += BYTES_PER_PIXEL )
+            {
+                StoreGray( pixel, ( column_parity == row_parity ) ? 0x00 : 0xff );
+                if( ++in_cell == cell )
+                {
+                    in_cell = 0;
+                    column_parity ^= 1;
+                }
+            }
+        }
+    }
+
+    // Sum of amplitudes over the octaves, to scale the fractal sums into 0..255.
+    float AmplitudeSum( const TextureSettings& settings, float amplitude )
+    {
+        float total = 0.0f;
+        for( int octave = 0; octave < settings.octaves; ++octave )
+        {
+            total += amplitude;
+            amplitude *= settings.gain;
+        }
+        return ( total > 0.0f ) ? total : 1.0f;
+    }
+
+    // One row of a noise pattern into buffers.noise, as 0..255 values, for texture
+    // columns [left, left + count) of texture row y.  Each octave is a batch row, the
+    // same terms stb's fractal functions add up one point at a time.
+    void NoiseRow( const TextureSettings& settings, const size_t left, const size_t count, const size_t y, RowBuffers& buffers )
+    {
+        const float dx = settings.scale / static_cast<float>( settings.width );
+        const float x0 = static_cast<float>( left ) * dx;
+        const float fy = static_cast<float>( y ) * settings.scale / static_cast<float>( settings.height );
+        const float z0 = settings.z + ( x0 + fy ) / 2.0f;
+        float* noise = buffers.noise.data();
+
+        if( settings.pattern == Pattern::Perlin )
+        {
+            perlin_batch::Noise3Row( x0, dx, fy, z0, dx / 2.0f, noise, count );
+            for( size_t i = 0; i < count; ++i )
+            {
+                // Noise is in [-1, 1]; the app's mapping to 0..255.
+                noise[ i ] = ( noise[ i ] + 1 ) * 128.0f;
+            }
+            return;
+        }
+
+        float* sum = buffers.sum.data();
+        std::fill( sum, sum + count, 0.0f );
+        float frequency = 1.0f;
+        float amplitude = ( settings.pattern == Pattern::Ridge ) ? 0.5f : 1.0f;
+        for( int octave = 0; octave < settings.octaves; ++octave )
+        {
+            perlin_batch::Noise3Row( x0 * frequency, dx * frequency, fy * frequency, z0 * frequency, dx / 2.0f * frequency,
+                                     noise, count, octave );
+            switch( settings.pattern )
+            {
+                case Pattern::Fbm:
+                    for( size_t i = 0; i < count; ++i )
+                    {
+                        sum[ i ] += noise[ i ] * amplitude;
+                    }
+                    break;
+                case Pattern::Turbulence:
+                    for( size_t i = 0; i < count; ++i )
+                    {
+                        sum[ i ] += std::fabs( noise[ i ] * amplitude );
+                    }
+                    break;
+                default:
+                    // Ridge: each octave is weighted by the one before it, so the row
+                    // of previous values lives where this octave's noise was.
+                    for( size_t i = 0; i < count; ++i )
+                    {
+                        float r = settings.offset - std::fabs( noise[ i ] );
+                        r = r * r;
+                        const float prev = ( octave == 0 ) ? 1.0f : buffers.noise[ count + i ];
+                        sum[ i ] += r * amplitude * prev;
+                        buffers.noise[ count + i ] = r;
+                    }
+                    break;
+            }
+            frequency *= settings.lacunarity;
+            amplitude *= settings.gain;
+        }
+
+        // fBm is signed, turbulence and ridge aren't.  Ridge terms top out at offset^4.
+        const float total = AmplitudeSum( settings, ( settings.pattern == Pattern::Ridge ) ? 0.5f : 1.0f );
+        const float ridge_max = settings.offset * settings.offset * settings.offset * settings.offset;
+        for( size_t i = 0; i < count; ++i )
+        {
+            switch( settings.pattern )
+            {
+                case Pattern::Fbm:        noise[ i ] = ( sum[ i ] / total + 1.0f ) * 127.5f; break;
+                case Pattern::Turbulence: noise[ i ] = sum[ i ] / total * 255.0f; break;
+                default:                  noise[ i ] = sum[ i ] / ( total * ridge_max ) * 255.0f; break;
+            }
+        }
+    }
+
+    void NoiseTile( const TextureSettings& settings, const size_t left, const size_t top, const size_t width, const size_t height,
+                    uint8_t* pixels, RowBuffers& buffers )
+    {
+        for( size_t y = top; y < top + height; ++y )
+        {
+            NoiseRow( settings, left, width, y, buffers );
+
+            uint8_t* pixel = pixels + ( y * settings.width + left ) * BYTES_PER_PIXEL;
+            for( size_t x = 0; x < width; ++x, pixel += BYTES_PER_PIXEL )
+            {
+                StoreGray( pixel, ToByte( buffers.noise[ x ] ) );
+            }
+        }
+    }
+
+    // PNG: 8 bit RGBA, no filtering, deflate "stored" (uncompressed) blocks.  Bigger
+    // files than a real compressor would make, but no dependencies and as fast as the
+    // disk.
+    uint32_t Crc32( const uint8_t* data, const size_t size, uint32_t crc = 0 )
+    {
+        static const auto table = []()
+        {
+            std::vector<uint32_t> entries( 256 );
+            for( uint32_t n = 0; n < 256; ++n )
+            {
+                uint32_t c = n;
+                for( int bit = 0; bit < 8; ++bit )
+                {
+                    c = ( c & 1 ) ? ( 0xEDB88320u ^ ( c >> 1 ) ) : ( c >> 1 );
+                }
+                entries[ n ] = c;
+            }
+            return entries;
+        }();
+
+        crc = ~crc;
+        for( size_t i = 0; i < size; ++i )
+        {
+            crc = table[ ( crc ^ data[ i ] ) & 0xff ] ^ ( crc >> 8 );
+        }
+        return ~crc;
+    }
+
+    void PutBigEndian( std::vector<uint8_t>& out, const uint32_t value )
+    {
+        out.push_back( static_cast<uint8_t>( value >> 24 ) );
+        out.push_back( static_cast<uint8_t>( value >> 16 ) );
+        out.push_back( static_cast<uint8_t>( value >> 8 ) );
+        out.push_back( static_cast<uint8_t>( value ) );
+    }
+
+    void WriteChunk( std::ofstream& file, const char* type, const std::vector<uint8_t>& data )
+    {
+        std::vector<uint8_t> header;
+        PutBigEndian( header, static_cast<uint32_t>( data.size() ) );
+        header.insert( header.end(), type, type + 4 );
+
+        const uint32_t crc = Crc32( data.data(), data.size(), Crc32( header.data() + 4, 4 ) );
+        std::vector<uint8_t> trailer;
+        PutBigEndian( trailer, crc );
+
+        file.write( reinterpret_cast<const char*>( header.data() ), header.size() );
+        file.write( reinterpret_cast<const char*>( data.data() ), data.size() );
+        file.write( reinterpret_cast<const char*>( trailer.data() ), trailer.size() );
+    }
+
+    // Collects the raw image stream (a filter byte, then each row) into stored deflate
+    // blocks, and those into IDAT chunks of about IDAT_SIZE.
+    class StoredDeflate
+    {
+    public:
+        static const size_t MAX_BLOCK = 65535;
+        static const size_t IDAT_SIZE = 1 << 20;
+
+        explicit StoredDeflate( std::ofstream& file )
+            : m_File( file )
+        {
+            m_Idat = { 0x78, 0x01 };    // zlib header: deflate, 32K window, no dictionary
+        }
+
+        void Add( const uint8_t* data, size_t size )
+        {
+            Adler( data, size );
+            while( size > 0 )
+            {
+                const size_t take = std::min( size, MAX_BLOCK - m_Block.size() );
+                m_Block.insert( m_Block.end(), data, data + take );
+                data += take;
+                size -= take;
+                if( m_Block.size() == MAX_BLOCK )
+                {
+                    FlushBlock( false );
+                }
+            }
+        }
+
+        void Finish()
+        {
+            FlushBlock( true );
+            PutBigEndian( m_Idat, ( m_AdlerB << 16 ) | m_AdlerA );
+            WriteChunk( m_File, "IDAT", m_Idat );
+        }
+
+    private:
+        void FlushBlock( const bool last )
+        {
+            const uint16_t length = static_cast<uint16_t>( m_Block.size() );
+            const uint8_t header[] = { static_cast<uint8_t>( last ? 1 : 0 ),
+                                       static_cast<uint8_t>( length ), static_cast<uint8_t>( length >> 8 ),
+                                       static_cast<uint8_t>( ~length ), static_cast<uint8_t>( ~length >> 8 ) };
+            m_Idat.insert( m_Idat.end(), header, header + sizeof( header ) );
+            m_Idat.insert( m_Idat.end(), m_Block.begin(), m_Block.end() );
+            m_Block.clear();
+
+            if( !last && m_Idat.size() >= IDAT_SIZE )
+            {
+                WriteChunk( m_File, "IDAT", m_Idat );
+                m_Idat.clear();
+            }
+        }
+
+        void Adler( const uint8_t* data, size_t size )
+        {
+            // 5552 bytes is the most that can be summed before the modulo without overflow.
+            while( size > 0 )
+            {
+                const size_t run = std::min<size_t>( size, 5552 );
+                for( size_t i = 0; i < run; ++i )
+                {
+                    m_AdlerA += data[ i ];
+                    m_AdlerB += m_AdlerA;
+                }
+                m_AdlerA %= 65521;
+                m_AdlerB %= 65521;
+                data += run;
+                size -= run;
+            }
+        }
+
+        std::ofstream&       m_File;
+        std::vector<uint8_t> m_Idat;
+        std::vector<uint8_t> m_Block;
+        uint32_t             m_AdlerA = 1;
+        uint32_t             m_AdlerB = 0;
+    };
+
+    bool WritePng( std::ofstream& file, const uint8_t* rgba, const size_t width, const size_t height )
+    {
+        static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        file.write( reinterpret_cast<const char*>( signature ), sizeof( signature ) );
+
+        std::vector<uint8_t> header;
+        PutBigEndian( header, static_cast<uint32_t>( width ) );
+        PutBigEndian( header, static_cast<uint32_t>( height ) );
+        header.insert( header.end(), { 8, 6, 0, 0, 0 } );    // 8 bits, RGBA, deflate, no filter, no interlace
+        WriteChunk( file, "IHDR", header );
+
+        StoredDeflate deflate( file );
+        const uint8_t no_filter = 0;
+        for( size_t y = 0; y < height; ++y )
+        {
+            deflate.Add( &no_filter, 1 );
+            deflate.Add( rgba + y * width * BYTES_PER_PIXEL, width * BYTES_PER_PIXEL );
+        }
+        deflate.Finish();
+
+        WriteChunk( file, "IEND", {} );
+        return file.good();
+    }
+
+    bool WritePpm( std::ofstream& file, const uint8_t* rgba, const size_t width, const size_t height )
+    {
+        file << "P6\n" << width << " " << height << "\n255\n";
+
+        std::vector<uint8_t> row( width * 3 );
+        for( size_t y = 0; y < height; ++y )
+        {
+            const uint8_t* pixel = rgba + y * width * BYTES_PER_PIXEL;
+            for( size_t x = 0; x < width; ++x, pixel += BYTES_PER_PIXEL )
+            {
+                row[ x * 3 ] = pixel[ 0 ];
+                row[ x * 3 + 1 ] = pixel[ 1 ];
+                row[ x * 3 + 2 ] = pixel[ 2 ];
+            }
+            file.write( reinterpret_cast<const char*>( row.data() ), row.size() );
+        }
+        return file.good();
+    }
+
+    bool EndsWith( const char* text, const char* suffix )
+    {
+        const size_t text_length = strlen( text );
+        const size_t suffix_length = strlen( suffix );
+        return text_length >= suffix_length && !strcmp( text + text_length - suffix_length, suffix );
+    }
+}
+
+int ThreadsFor( const TextureSettings& settings )
+{
+    if( settings.threads > 0 )
+    {
+        return settings.threads;
+    }
+    // More than the pool has is all of them.
+    const size_t pixels = settings.width * settings.height;
+    return static_cast<int>( std::max<size_t>( 1, std::min<size_t>( INT_MAX, pixels / MIN_PIXELS_PER_THREAD ) ) );
+}
+
+bool ParsePattern( const char* name, Pattern& pattern )
+{
+    static const struct { const char* name; Pattern pattern; } patterns[] =
+    {
+        { "checkerboard", Pattern::Checkerboard },
+        { "perlin",       Pattern::Perlin },
+        { "fbm",          Pattern::Fbm },
+        { "ridge",        Pattern::Ridge },
+        { "turbulence",   Pattern::Turbulence },
+    };
+    for( const auto& entry : patterns )
+    {
+        if( !strcmp( name, entry.name ) )
+        {
+            pattern = entry.pattern;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<uint8_t> GenerateRGBA( const TextureSettings& settings, WorkerPool& pool )
+{
+    std::vector<uint8_t> pixels( settings.width * settings.height * BYTES_PER_PIXEL );
+
+    const size_t tile = std::max<size_t>( 1, settings.tile_size );
+    const size_t tiles_across = ( settings.width + tile - 1 ) / tile;
+    const size_t tile_count = tiles_across * ( ( settings.height + tile - 1 ) / tile );
+
+    // Tiles go to the pool's threads; a tile's buffers belong to whichever thread runs
+    // it, and are kept for that thread's next tile (or next texture).
+    pool.Run( tile_count, ThreadsFor( settings ), [&]( const size_t t )
+    {
+        thread_local RowBuffers buffers;
+        if( buffers.sum.size() < tile )
+        {
+            buffers.noise.resize( tile * 2 );   // ridge keeps the previous octave in the top half
+            buffers.sum.resize( tile );
+        }
+
+        const size_t left = ( t % tiles_across ) * tile;
+        const size_t top = ( t / tiles_across ) * tile;
+        const size_t width = std::min( tile, settings.width - left );
+        const size_t height = std::min( tile, settings.height - top );
+
+        if( settings.pattern == Pattern::Checkerboard )
+        {
+            CheckerboardTile( settings, left, top, width, height, pixels.data() );
+        }
+        else
+        {
+            NoiseTile( settings, left, top, width, height, pixels.data(), buffers );
+        }
+    } );
+
+    return pixels;
+}
+
+bool WriteImage( const char* path, const uint8_t* rgba, const size_t width, const size_t height )
+{
+    const bool png = EndsWith( path, ".png" );
+    if( !png && !EndsWith( path, ".ppm" ) )
+    {
+        return false;
+    }
+
+    std::ofstream file( path, std::ios::binary );
+    if( !file )
+    {
+        return false;
+    }
+    return png ? WritePng( file, rgba, width, height ) : WritePpm( file, rgba, width, height );
+}
+
+}
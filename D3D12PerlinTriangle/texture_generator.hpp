@@ -0,0 +1,67 @@
+#pragma once
+// Procedural RGBA8 textures, generated in square tiles on all cores.
+//
+// The app's two background textures (checkerboard and Perlin noise) plus stb_perlin's
+// three fractal noises, with no D3D dependency so textures can be baked offline at any
+// size.  Tiles are handed to the threads of a pool that lives as long as the program
+// (WorkerPool::Shared), so generating texture after texture doesn't start threads each
+// time.  A tile's output depends only on its position, never on which thread ran it,
+// so any thread count produces the same bytes.
+//
+// Noise is sampled at x, y in [0, scale) across the texture and z = z + ( x + y ) / 2,
+// the app's original mapping when scale is 1 and z is 0.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "worker_pool.hpp"
+
+namespace texture_gen
+{
+    enum class Pattern
+    {
+        Checkerboard,   // 8 x 8 black and white cells
+        Perlin,         // stb_perlin_noise3
+        Fbm,            // stb_perlin_fbm_noise3: octaves summed
+        Ridge,          // stb_perlin_ridge_noise3: sharp creases
+        Turbulence,     // stb_perlin_turbulence_noise3: sum of absolute values
+    };
+
+    struct TextureSettings
+    {
+        size_t  width = 256;
+        size_t  height = 256;
+        Pattern pattern = Pattern::Perlin;
+
+        float   scale = 1.0f;       // noise periods across the texture
+        float   z = 0.0f;           // slice through the noise; animate this
+        int     octaves = 6;        // fractal patterns only
+        float   lacunarity = 2.0f;
+        float   gain = 0.5f;
+        float   offset = 1.0f;      // ridge only
+
+        int     threads = 0;        // 0: one per core, fewer for small textures; at most the pool's
+        size_t  tile_size = 64;
+    };
+
+    static const size_t BYTES_PER_PIXEL = 4;
+
+    // With threads = 0, a texture gets a thread per this many pixels, up to one per
+    // core: below that, waking another thread costs more than it saves.
+    static const size_t MIN_PIXELS_PER_THREAD = 1 << 16;
+
+    // How many threads to ask the pool for, for a texture with these settings.
+    int ThreadsFor( const TextureSettings& settings );
+
+    // Pattern by name ("checkerboard", "perlin", "fbm", "ridge", "turbulence").
+    // Returns false if the name isn't one of those.
+    bool ParsePattern( const char* name, Pattern& pattern );
+
+    // width * height RGBA8 pixels, rows packed, generated on pool's threads.
+    std::vector<uint8_t> GenerateRGBA( const TextureSettings& settings, WorkerPool& pool = WorkerPool::Shared() );
+
+    // Image files, by extension: .png (uncompressed, RGBA) or .ppm (binary, RGB).
+    // Returns false if the file can't be written or the extension isn't known.
+    bool WriteImage( const char* path, const uint8_t* rgba, size_t width, size_t height );
+}
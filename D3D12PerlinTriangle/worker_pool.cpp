@@ -0,0 +1,111 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+
+namespace texture_gen
+{
+
+WorkerPool::WorkerPool( const int threads )
+{
+    for( int worker = 0; worker < threads - 1; ++worker )
+    {
+        m_Workers.emplace_back( &WorkerPool::WorkerLoop, this, worker );
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> guard( m_Mutex );
+        m_Stop = true;
+    }
+    m_Wake.notify_all();
+    for( std::thread& worker : m_Workers )
+    {
+        worker.join();
+    }
+}
+
+WorkerPool& WorkerPool::Shared()
+{
+    static WorkerPool pool( std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) ) );
+    return pool;
+}
+
+void WorkerPool::Run( const size_t count, int max_threads, const std::function<void( size_t )>& job )
+{
+    if( max_threads <= 0 || max_threads > Threads() )
+    {
+        max_threads = Threads();
+    }
+    max_threads = static_cast<int>( std::min<size_t>( max_threads, count ) );
+    if( max_threads <= 1 || t_InJob )
+    {
+        // Nothing worth waking anyone for, or called from a job: the pool's workers may
+        // all be busy with (or waiting on) that job, and m_RunMutex is taken.
+        for( size_t index = 0; index < count; ++index )
+        {
+            job( index );
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_guard( m_RunMutex );
+    {
+        std::lock_guard<std::mutex> guard( m_Mutex );
+        m_Job = &job;
+        m_Count = count;
+        m_Next = 0;
+        m_Active = max_threads - 1;
+        m_Pending = m_Active;
+        ++m_Generation;
+    }
+    m_Wake.notify_all();
+
+    Drain();
+
+    // Every worker that was asked checks in, even if the caller already took the last
+    // index, so none can still be looking at job after this returns.
+    std::unique_lock<std::mutex> lock( m_Mutex );
+    m_Done.wait( lock, [this]() { return m_Pending == 0; } );
+    m_Job = nullptr;
+}
+
+void WorkerPool::Drain()
+{
+    t_InJob = true;
+    for( size_t index = m_Next.fetch_add( 1 ); index < m_Count; index = m_Next.fetch_add( 1 ) )
+    {
+        ( *m_Job )( index );
+    }
+    t_InJob = false;
+}
+
+void WorkerPool::WorkerLoop( const int worker )
+{
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock( m_Mutex );
+    for( ;; )
+    {
+        m_Wake.wait( lock, [this, seen]() { return m_Stop || m_Generation != seen; } );
+        if( m_Stop )
+        {
+            return;
+        }
+        seen = m_Generation;
+        if( worker >= m_Active )
+        {
+            continue;
+        }
+
+        lock.unlock();
+        Drain();
+        lock.lock();
+        if( --m_Pending == 0 )
+        {
+            m_Done.notify_one();
+        }
+    }
+}
+
+}
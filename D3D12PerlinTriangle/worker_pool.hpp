@@ -0,0 +1,68 @@
+#pragma once
+// A few threads kept for the life of the program, for texture work that runs over and
+// over (a frame at a time) and shouldn't pay for creating threads on every call.
+//
+// Run hands out indices [0, count) from an atomic counter to the calling thread and up
+// to max_threads - 1 of the pool's workers, and returns once every index is done.
+// One Run at a time; concurrent callers take turns.  A job that calls Run itself (say
+// a tile that generates a texture of its own) gets it run inline on its own thread,
+// rather than waiting on a pool that's busy with the job that's waiting.
+//
+// A pool never runs more threads than it was made with: Shared() has one per core,
+// so asking it for more gets one per core.  Make a pool of the size wanted to run
+// more threads than that (or a fixed number whatever the machine).
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace texture_gen
+{
+    class WorkerPool
+    {
+    public:
+        // threads counts the caller, so threads - 1 workers are started.
+        explicit WorkerPool( int threads );
+        ~WorkerPool();
+
+        WorkerPool( const WorkerPool& ) = delete;
+        WorkerPool& operator=( const WorkerPool& ) = delete;
+
+        // Caller plus workers.
+        int Threads() const { return static_cast<int>( m_Workers.size() ) + 1; }
+
+        // job( index ) for every index in [0, count), on at most max_threads threads
+        // (0, or more than Threads(): all of them).
+        void Run( size_t count, int max_threads, const std::function<void( size_t )>& job );
+
+        // One thread per core, started on first use.
+        static WorkerPool& Shared();
+
+    private:
+        void WorkerLoop( int worker );
+        void Drain();
+
+        std::vector<std::thread> m_Workers;
+        std::mutex               m_RunMutex;    // one Run at a time
+
+        std::mutex               m_Mutex;
+        std::condition_variable  m_Wake;
+        std::condition_variable  m_Done;
+        uint64_t                 m_Generation = 0;
+        int                      m_Active = 0;  // workers taking part in this Run
+        int                      m_Pending = 0; // of those, not finished yet
+        bool                     m_Stop = false;
+
+        const std::function<void( size_t )>* m_Job = nullptr;
+        size_t                               m_Count = 0;
+        std::atomic<size_t>                  m_Next{ 0 };
+
+        // Set while this thread runs a job for any pool.
+        static inline thread_local bool      t_InJob = false;
+    };
+}
@@ -1,7 +1,19 @@
 // DiamondPrinter.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.hpp"
 
 void line_printer_dual_loop( int edge_length )
 {
@@ -191,8 +203,427 @@ void line_printer_single_loop_abs( int edge_length )
     }
 }
 
-int main()
+// Total characters in the diamond, newlines included.
+// Line x (counting from the top) has |edge_length - x - 1| leading spaces, one or two
+// stars with the inner spaces between them, and a newline; adding it all up gives
+// ( 2n - 1 )( n + 1 ) + ( n - 1 )^2.
+size_t diamond_size( int edge_length )
+{
+    if( edge_length <= 0 )
+    {
+        return 0;
+    }
+    const size_t n = static_cast<size_t>( edge_length );
+    return ( ( 2 * n - 1 ) * ( n + 1 ) ) + ( ( n - 1 ) * ( n - 1 ) );
+}
+
+// Same line equations as line_printer_single_loop_abs, but each run of spaces is a
+// single memset into memory instead of one stream call per character.
+// out must hold diamond_size( edge_length ) characters.  Returns the count written.
+size_t render_diamond( int edge_length, char* out )
+{
+    char* next = out;
+    for( int x = 0; x < ( edge_length * 2 ) - 1; ++x )
+    {
+        const int y0 = abs( edge_length - x - 1 );
+        const int y1 = ( -2 * abs( x - edge_length + 1 ) ) + ( 2 * edge_length ) - 3;
+
+        memset( next, ' ', y0 );
+        next += y0;
+        *next++ = '*';
+
+        // Only lines with inner spaces get the second star.
+        if( y1 > 0 )
+        {
+            memset( next, ' ', y1 );
+            next += y1;
+            *next++ = '*';
+        }
+
+        *next++ = '\n';
+    }
+    return static_cast<size_t>( next - out );
+}
+
+// Render the whole diamond into buffer (grown if it's too small, and kept for next
+// time), then hand it to the stream in one write.
+void line_printer_buffered( int edge_length, std::vector<char>& buffer )
+{
+    const size_t size = diamond_size( edge_length );
+    if( buffer.size() < size )
+    {
+        buffer.resize( size );
+    }
+    std::cout.write( buffer.data(), render_diamond( edge_length, buffer.data() ) );
+}
+
+void line_printer_buffered( int edge_length )
+{
+    std::vector<char> buffer;
+    line_printer_buffered( edge_length, buffer );
+}
+
+// The bottom half is the top half upside down: line 2n - 2 - k is the same as line k.
+// Counting lines from either end, the first c lines take c( n + 1 ) + c( c - 1 ) / 2
+// characters, so top line k starts at lines_size( n, k ) and its mirror starts at
+// diamond_size( n ) - lines_size( n, k + 1 ).
+size_t lines_size( size_t n, size_t count )
+{
+    return ( count * ( n + 1 ) ) + ( ( count * ( count - 1 ) ) / 2 );
+}
+
+// Top line k (0 = the point): n - 1 - k leading spaces, the stars 2k apart.
+size_t render_top_line( int edge_length, int k, char* out )
+{
+    char* next = out;
+    memset( next, ' ', edge_length - 1 - k );
+    next += edge_length - 1 - k;
+    *next++ = '*';
+    if( k > 0 )
+    {
+        memset( next, ' ', ( 2 * k ) - 1 );
+        next += ( 2 * k ) - 1;
+        *next++ = '*';
+    }
+    *next++ = '\n';
+    return static_cast<size_t>( next - out );
+}
+
+// Lines per chunk of work handed to a thread.
+static const int MIRROR_CHUNK_LINES = 64;
+
+// Below this many characters a single thread wins; starting threads costs more.
+static const size_t PARALLEL_MIN_SIZE = 1 << 20;
+
+// Builds each top line once and copies it to its mirror in the bottom half.  Every
+// line's position is known up front, so threads fill disjoint chunks of lines with
+// no coordination beyond taking the next chunk.  thread_count 0 = one per core.
+// out must hold diamond_size( edge_length ) characters.  Returns the count written.
+size_t render_diamond_mirrored( int edge_length, char* out, unsigned thread_count = 1 )
+{
+    const size_t size = diamond_size( edge_length );
+    if( size == 0 )
+    {
+        return 0;
+    }
+
+    const size_t n = static_cast<size_t>( edge_length );
+    const int chunks = ( edge_length + MIRROR_CHUNK_LINES - 1 ) / MIRROR_CHUNK_LINES;
+    if( size < PARALLEL_MIN_SIZE )
+    {
+        thread_count = 1;
+    }
+    else if( thread_count == 0 )
+    {
+        thread_count = std::max( 1u, std::thread::hardware_concurrency() );
+    }
+    thread_count = std::min( thread_count, static_cast<unsigned>( chunks ) );
+
+    std::atomic<int> next_chunk( 0 );
+    auto worker = [ & ]()
+    {
+        for( int chunk = next_chunk++; chunk < chunks; chunk = next_chunk++ )
+        {
+            const int first = chunk * MIRROR_CHUNK_LINES;
+            const int last = std::min( first + MIRROR_CHUNK_LINES, edge_length );
+            for( int k = first; k < last; ++k )
+            {
+                char* line = out + lines_size( n, k );
+                const size_t length = render_top_line( edge_length, k, line );
+
+                // The middle line (k = n - 1) is its own mirror.
+                if( k < edge_length - 1 )
+                {
+                    memcpy( out + size - lines_size( n, k + 1 ), line, length );
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for( unsigned index = 1; index < thread_count; ++index )
+    {
+        threads.emplace_back( worker );
+    }
+    worker();
+    for( std::thread& thread : threads )
+    {
+        thread.join();
+    }
+    return size;
+}
+
+// Write the diamond straight into a memory-mapped file; nothing goes through a
+// stream or an intermediate buffer.  Returns false if the file can't be created.
+bool write_diamond_file( int edge_length, const char* path, unsigned thread_count = 0 )
+{
+    MappedFile file;
+    if( !file.Create( path, diamond_size( edge_length ) ) )
+    {
+        return false;
+    }
+    render_diamond_mirrored( edge_length, file.Data(), thread_count );
+    return true;
+}
+
+// Stream buffers for the benchmark: one throws everything away, so only the
+// printer's own cost is timed, the other hashes everything (FNV-1a) so the outputs
+// of different printers can be compared without storing them.
+class NullStreamBuffer : public std::streambuf
+{
+protected:
+    int_type overflow( int_type ch ) override
+    {
+        return traits_type::not_eof( ch );
+    }
+
+    std::streamsize xsputn( const char*, std::streamsize count ) override
+    {
+        return count;
+    }
+};
+
+class HashStreamBuffer : public std::streambuf
+{
+public:
+    uint64_t Hash() const { return m_Hash; }
+
+protected:
+    int_type overflow( int_type ch ) override
+    {
+        if( !traits_type::eq_int_type( ch, traits_type::eof() ) )
+        {
+            Add( traits_type::to_char_type( ch ) );
+        }
+        return traits_type::not_eof( ch );
+    }
+
+    std::streamsize xsputn( const char* text, std::streamsize count ) override
+    {
+        for( std::streamsize n = 0; n < count; ++n )
+        {
+            Add( text[ n ] );
+        }
+        return count;
+    }
+
+private:
+    void Add( const char ch )
+    {
+        m_Hash = ( m_Hash ^ static_cast<unsigned char>( ch ) ) * 0x100000001B3ull;
+    }
+
+    uint64_t m_Hash = 0xCBF29CE484222325ull;
+};
+
+typedef void ( *Printer )( int );
+typedef void ( *BufferedPrinter )( int, std::vector<char>& );
+
+struct NamedPrinter
+{
+    const char*     name;
+    Printer         print;
+    BufferedPrinter print_reusing;  // same output into a caller's buffer, or nullptr
+};
+
+static const NamedPrinter PRINTERS[] =
+{
+    { "dual loop",       line_printer_dual_loop,       nullptr },
+    { "single loop",     line_printer_single_loop,     nullptr },
+    { "single loop abs", line_printer_single_loop_abs, nullptr },
+    { "buffered",        line_printer_buffered,        line_printer_buffered },
+};
+
+// Every printer must produce exactly the same characters.
+bool VerifyPrinters()
+{
+    std::streambuf* original = std::cout.rdbuf();
+    bool match = true;
+    for( int edge_length = 1; edge_length <= 300 && match; edge_length += ( edge_length < 20 ) ? 1 : 37 )
+    {
+        uint64_t expected = 0;
+        for( const NamedPrinter& printer : PRINTERS )
+        {
+            HashStreamBuffer hash;
+            std::cout.rdbuf( &hash );
+            printer.print( edge_length );
+            std::cout.rdbuf( original );
+
+            if( &printer == &PRINTERS[ 0 ] )
+            {
+                expected = hash.Hash();
+            }
+            else if( hash.Hash() != expected )
+            {
+                std::cout << printer.name << " differs at edge length " << edge_length << "\n";
+                match = false;
+            }
+        }
+    }
+    return match;
+}
+
+// The in-memory renderers must match render_diamond byte for byte, and so must a
+// file written through the memory map.
+bool VerifyRenderers()
+{
+    std::vector<char> expected;
+    std::vector<char> actual;
+    for( int edge_length = 1; edge_length <= 2000; edge_length += ( edge_length < 70 ) ? 1 : 331 )
+    {
+        const size_t size = diamond_size( edge_length );
+        expected.assign( size, 0 );
+        render_diamond( edge_length, expected.data() );
+
+        for( unsigned threads = 1; threads <= 4; threads += 3 )
+        {
+            actual.assign( size, 0 );
+            if( render_diamond_mirrored( edge_length, actual.data(), threads ) != size || actual != expected )
+            {
+                std::cout << "mirrored renderer (" << threads << " threads) differs at edge length " << edge_length << "\n";
+                return false;
+            }
+        }
+    }
+
+    // Big enough to go parallel.
+    static const int FILE_EDGE = 1000;
+    static const char* FILE_NAME = "diamond_verify.txt";
+    expected.assign( diamond_size( FILE_EDGE ), 0 );
+    render_diamond( FILE_EDGE, expected.data() );
+    if( !write_diamond_file( FILE_EDGE, FILE_NAME ) )
+    {
+        std::cout << "couldn't create " << FILE_NAME << "\n";
+        return false;
+    }
+
+    actual.assign( expected.size() + 1, 0 );
+    FILE* file = fopen( FILE_NAME, "rb" );
+    const size_t read = file ? fread( actual.data(), 1, actual.size(), file ) : 0;
+    if( file )
+    {
+        fclose( file );
+    }
+    remove( FILE_NAME );
+    actual.resize( read );
+    if( actual != expected )
+    {
+        std::cout << "memory-mapped file differs\n";
+        return false;
+    }
+    return true;
+}
+
+// In-memory renderers only: one pass of line equations, the mirrored line cache on one
+// thread, and the mirrored line cache on every core.
+void RendererBenchmark()
+{
+    static const int REP_COUNT = 5;
+
+    std::vector<char> buffer;
+    printf( "\n%-22s %8s %12s %10s\n", "Renderer", "Edge", "ms", "GB/s" );
+    for( int edge_length = 100; edge_length <= 10000; edge_length *= 10 )
+    {
+        buffer.assign( diamond_size( edge_length ), 0 );
+        const double gigabytes = buffer.size() / 1e9;
+
+        for( int variant = 0; variant < 3; ++variant )
+        {
+            static const char* NAMES[] = { "render_diamond", "mirrored, 1 thread", "mirrored, all cores" };
+            double best = 1e30;
+            for( int rep = 0; rep < REP_COUNT; ++rep )
+            {
+                const auto start = std::chrono::steady_clock::now();
+                switch( variant )
+                {
+                case 0: render_diamond( edge_length, buffer.data() ); break;
+                case 1: render_diamond_mirrored( edge_length, buffer.data(), 1 ); break;
+                case 2: render_diamond_mirrored( edge_length, buffer.data(), 0 ); break;
+                }
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                best = std::min( best, elapsed.count() );
+            }
+            printf( "%-22s %8d %12.3f %10.2f\n", NAMES[ variant ], edge_length, best * 1e3, gigabytes / best );
+        }
+    }
+}
+
+// Time every printer at edge lengths 10 .. 10^4 with output going nowhere.
+void PrinterBenchmark()
 {
+    static const int REP_COUNT = 3;
+
+    std::streambuf* original = std::cout.rdbuf();
+    NullStreamBuffer null_buffer;
+    std::vector<char> buffer;
+
+    printf( "%-16s %8s %12s %10s\n", "Printer", "Edge", "ms", "MB/s" );
+    for( int edge_length = 10; edge_length <= 10000; edge_length *= 10 )
+    {
+        // The character-at-a-time printers take seconds at the largest size.
+        const int reps = ( edge_length >= 10000 ) ? 1 : REP_COUNT;
+        const double megabytes = diamond_size( edge_length ) / 1e6;
+        buffer.resize( diamond_size( edge_length ) );    // allocate and fault in outside the timing
+
+        for( const NamedPrinter& printer : PRINTERS )
+        {
+            double best = 1e30;
+            for( int rep = 0; rep < reps; ++rep )
+            {
+                std::cout.rdbuf( &null_buffer );
+                const auto start = std::chrono::steady_clock::now();
+                if( printer.print_reusing )
+                {
+                    printer.print_reusing( edge_length, buffer );
+                }
+                else
+                {
+                    printer.print( edge_length );
+                }
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                std::cout.rdbuf( original );
+                best = std::min( best, elapsed.count() );
+            }
+            printf( "%-16s %8d %12.3f %10.1f\n", printer.name, edge_length, best * 1e3, megabytes / best );
+        }
+    }
+}
+
+// DiamondPrinter                                - asks for a side length and prints the diamond
+// DiamondPrinter bench                          - checks all printers agree, then times them
+// DiamondPrinter file <edge> <path> [threads]   - writes the diamond to a memory-mapped file
+int main( int argc, char* argv[] )
+{
+    if( argc > 1 && strcmp( argv[ 1 ], "bench" ) == 0 )
+    {
+        if( !VerifyPrinters() || !VerifyRenderers() )
+        {
+            return 1;
+        }
+        std::cout << "All printers match.\n";
+        PrinterBenchmark();
+        RendererBenchmark();
+        return 0;
+    }
+
+    if( argc > 3 && strcmp( argv[ 1 ], "file" ) == 0 )
+    {
+        const int edge_length = atoi( argv[ 2 ] );
+        const unsigned threads = ( argc > 4 ) ? static_cast<unsigned>( atoi( argv[ 4 ] ) ) : 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        if( !write_diamond_file( edge_length, argv[ 3 ], threads ) )
+        {
+            std::cout << "Couldn't write " << argv[ 3 ] << "\n";
+            return 1;
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const double gigabytes = diamond_size( edge_length ) / 1e9;
+        printf( "Wrote %.3f GB to %s in %.3f s (%.2f GB/s)\n", gigabytes, argv[ 3 ], elapsed.count(), gigabytes / elapsed.count() );
+        return 0;
+    }
+
     // Get the user input...
     int edge_length;
     std::cout << "Enter the side length: ";
@@ -204,8 +635,11 @@ int main()
     //std::cout << "Single loop print:\n";
     //line_printer_single_loop( edge_length );
 
-    std::cout << "Single loop abs print:\n";
-    line_printer_single_loop_abs( edge_length );
+    //std::cout << "Single loop abs print:\n";
+    //line_printer_single_loop_abs( edge_length );
+
+    std::cout << "Buffered print:\n";
+    line_printer_buffered( edge_length );
 }
 
 // Run program: Ctrl + F5 or Debug > Start Without Debugging menu
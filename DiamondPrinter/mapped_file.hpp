@@ -0,0 +1,129 @@
+#pragma once
+// Minimal writable memory-mapped file, Windows and POSIX.
+//
+// Create() makes (or truncates) the file at the requested size and maps all of it,
+// so the program can write the file's contents straight into memory and let the OS
+// page them out to disk.
+
+#include <cstddef>
+
+#if defined( _WIN32 )
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    // Returns false if the file can't be created, sized or mapped.
+    bool Create( const char* path, const size_t size )
+    {
+        Close();
+        m_Size = size;
+
+#if defined( _WIN32 )
+        m_File = CreateFileA( path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr );
+        if( m_File == INVALID_HANDLE_VALUE )
+        {
+            return false;
+        }
+        if( size == 0 )
+        {
+            return true;    // can't map an empty file, and don't need to
+        }
+
+        const unsigned long long size64 = size;
+        m_Mapping = CreateFileMappingA( m_File, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>( size64 >> 32 ), static_cast<DWORD>( size64 ), nullptr );
+        if( !m_Mapping )
+        {
+            Close();
+            return false;
+        }
+        m_Data = static_cast<char*>( MapViewOfFile( m_Mapping, FILE_MAP_WRITE, 0, 0, size ) );
+#else
+        m_File = open( path, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+        if( m_File < 0 )
+        {
+            return false;
+        }
+        if( size == 0 )
+        {
+            return true;
+        }
+        if( ftruncate( m_File, static_cast<off_t>( size ) ) != 0 )
+        {
+            Close();
+            return false;
+        }
+
+        void* data = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_File, 0 );
+        m_Data = ( data == MAP_FAILED ) ? nullptr : static_cast<char*>( data );
+#endif
+        if( !m_Data )
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    char*  Data() { return m_Data; }
+    size_t Size() const { return m_Size; }
+
+    // Unmap and close.  The OS writes dirty pages back on its own schedule.
+    void Close()
+    {
+#if defined( _WIN32 )
+        if( m_Data )
+        {
+            UnmapViewOfFile( m_Data );
+        }
+        if( m_Mapping )
+        {
+            CloseHandle( m_Mapping );
+        }
+        if( m_File != INVALID_HANDLE_VALUE )
+        {
+            CloseHandle( m_File );
+        }
+        m_Mapping = nullptr;
+        m_File = INVALID_HANDLE_VALUE;
+#else
+        if( m_Data )
+        {
+            munmap( m_Data, m_Size );
+        }
+        if( m_File >= 0 )
+        {
+            close( m_File );
+        }
+        m_File = -1;
+#endif
+        m_Data = nullptr;
+        m_Size = 0;
+    }
+
+private:
+    char*  m_Data = nullptr;
+    size_t m_Size = 0;
+#if defined( _WIN32 )
+    HANDLE m_File = INVALID_HANDLE_VALUE;
+    HANDLE m_Mapping = nullptr;
+#else
+    int    m_File = -1;
+#endif
+};
@@ -1,20 +1,62 @@
 #include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
+#include <random>
+#include <unordered_map>
 #include <vector>
 
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
+// OS-specific bits: Windows headers and the QPC shim for non-Windows, same as FastSphereCollision.
+#if defined( _WIN32 )
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <ctime>
+
+    typedef struct
+    {
+        long long QuadPart;
+    } LARGE_INTEGER;
+
+    inline void QueryPerformanceFrequency( LARGE_INTEGER *lpFrequency )
+    {
+        lpFrequency->QuadPart = 1000000000LL; // nanoseconds per second
+    }
+
+    inline void QueryPerformanceCounter( LARGE_INTEGER *lpPerformanceCount )
+    {
+        struct timespec ts;
+        if( clock_gettime( CLOCK_MONOTONIC, &ts ) != 0 )
+        {
+            lpPerformanceCount->QuadPart = 0;
+            return;
+        }
+
+        lpPerformanceCount->QuadPart =
+            static_cast< long long >( ts.tv_sec ) * 1000000000LL + ts.tv_nsec;
+    }
+#endif
+
+#if defined( __x86_64__ ) || defined( _M_X64 )
+    #include <emmintrin.h>
+#elif defined( __aarch64__ )
+    #include <arm_neon.h>
+#endif
 
 static const unsigned int target = 5;
 
-inline void test_case_0( std::vector<unsigned int>& nums, unsigned int& total )
+// test_case_0..3 work on [ begin, end ), a slice of one shared input buffer.
+// They consume (reorder or shrink) their slice as they go.
+
+inline void test_case_0( unsigned int* begin, unsigned int* end, unsigned int& total )
 {
-    while( nums.size() )
+    while( begin != end )
     {
         // This is O(n^2) because count_if checks every element.
-        const unsigned int first = nums.back();
-        nums.pop_back();
+        const unsigned int first = *( end - 1 );
+        --end;
 
         // Assume that there are values <= target in the array...
         // Unsigned declaration already defines no values less than zero, so
@@ -26,20 +68,20 @@ inline void test_case_0( std::vector<unsigned int>& nums, unsigned int& total )
         }
 
         const unsigned int find = target - first;
-        total += std::count_if( nums.begin(),
-                                nums.end(),
+        total += std::count_if( begin,
+                                end,
                                 [ find ](const int& a){ return a == find; } );
     }
 }
 
-inline void test_case_1( std::vector<unsigned int>& nums, unsigned int& total )
+inline void test_case_1( unsigned int* begin, unsigned int* end, unsigned int& total )
 {
-    while( nums.size() )
+    while( begin != end )
     {
         // This is still 0(n^2), but worse than the solution above because
         // there are two instances of the count_if construct, each of which is
         // O(n^2).
-        const unsigned int first = nums.back();
+        const unsigned int first = *( end - 1 );
 
         // Assume that there are values <= target in the array...
         // Unsigned declaration already defines no values less than zero, so
@@ -47,21 +89,21 @@ inline void test_case_1( std::vector<unsigned int>& nums, unsigned int& total )
         if( first > target )
         {
             // > target allows zeros in the list.
-            nums.pop_back();
+            --end;
             continue;
         }
 
         unsigned int x_count = std::count_if(
-            nums.begin(),
-            nums.end(),
+            begin,
+            end,
             [ first ](const unsigned int& a){ return a == first; } );
 
         if( first + first != target )
         {
             const unsigned int find = target - first;
             unsigned int y_count = std::count_if(
-                nums.begin(),
-                nums.end(),
+                begin,
+                end,
                 [ find ](const int& a){ return a == find; } );
 
             total += x_count * y_count;
@@ -72,20 +114,20 @@ inline void test_case_1( std::vector<unsigned int>& nums, unsigned int& total )
             total += ( x_count * ( x_count - 1 ) ) / 2;
         }
 
-        // With -O3 flag this should be faster than looping on pop_back()
-        nums.erase( nums.end() - x_count, nums.end() );
+        // Drop every copy of first at once rather than one at a time
+        end -= x_count;
     }
 }
 
-inline void test_case_2( std::vector<unsigned int>& nums, unsigned int& total )
+inline void test_case_2( unsigned int* begin, unsigned int* end, unsigned int& total )
 {
     // Use the fact that the vector is sorted to avoid checking all elements.
 
     // I don't know how to calculate the time complexity of this one, but the
     // perf runs show that this solution is worse than the previous two because
     // of the three binary search loops.
-    auto big_last = nums.end();
-    while( nums.begin() != big_last )
+    auto big_last = end;
+    while( begin != big_last )
     {
         big_last--;
 
@@ -99,7 +141,7 @@ inline void test_case_2( std::vector<unsigned int>& nums, unsigned int& total )
         }
 
         // Binary search #1
-        auto big_first = std::lower_bound( nums.begin(), big_last, *big_last );
+        auto big_first = std::lower_bound( begin, big_last, *big_last );
         unsigned int x_count = std::distance( big_first, big_last ) + 1;
 
         if( ( ( *big_last ) * 2 ) != target )
@@ -108,8 +150,8 @@ inline void test_case_2( std::vector<unsigned int>& nums, unsigned int& total )
 
             // Binary search #2
             unsigned int y_count = 0;
-            auto small_first = std::lower_bound( nums.begin(), big_first, find );
-            if( nums.end() != small_first && find == *small_first )
+            auto small_first = std::lower_bound( begin, big_first, find );
+            if( end != small_first && find == *small_first )
             {
                 // Binary search #3
                 auto small_last = std::upper_bound( small_first, big_first, find );
@@ -128,13 +170,16 @@ inline void test_case_2( std::vector<unsigned int>& nums, unsigned int& total )
     }
 }
 
-inline void test_case_3( std::vector<unsigned int>& nums, unsigned int& total )
+// TotalT is unsigned int for the small fixed tests; the random inputs need uint64_t,
+// since 10^6 values already have more than 2^32 pairs.
+template< typename TotalT >
+inline void test_case_3( unsigned int* begin, unsigned int* end, TotalT& total )
 {
     // Try a simple two pointer solution.
     // This is definitely O(n) and perf runs show it to be much faster than
     // the other three solutions.
-    unsigned int* front = nums.data();
-    unsigned int* back = nums.data() + nums.size() - 1;
+    unsigned int* front = begin;
+    unsigned int* back = end - 1;
 
     while( front < back )
     {
@@ -144,7 +189,7 @@ inline void test_case_3( std::vector<unsigned int>& nums, unsigned int& total )
             --back;
         }
 
-        unsigned int x_count = 1;
+        TotalT x_count = 1;
         while( *back == *( back - 1 ) )
         {
             ++x_count;
@@ -158,7 +203,7 @@ inline void test_case_3( std::vector<unsigned int>& nums, unsigned int& total )
                 ++front;
             }
 
-            unsigned int y_count = 0;
+            TotalT y_count = 0;
             while( *front + *back == target )
             {
                 ++y_count;
@@ -177,67 +222,295 @@ inline void test_case_3( std::vector<unsigned int>& nums, unsigned int& total )
     }
 }
 
-static const std::vector<unsigned int> nums = { 1, 1, 2, 2, 3, 3, 4, 5 };
-static const int repititions = 1000000;
+// The variants below don't need sorted input and don't modify it, and they count
+// into 64 bits too: even 10^6 random elements have more than 2^32 pairs.
 
-std::array<std::vector<unsigned int>, repititions> test_cases;
+// Pairs from per-value counts: every x below target / 2 pairs with every
+// ( target - x ), and a value that's exactly half of target pairs with itself.
+inline uint64_t pairs_from_histogram( const uint64_t* histogram )
+{
+    uint64_t total = 0;
+    for( unsigned int x = 0; x + x < target; ++x )
+    {
+        total += histogram[ x ] * histogram[ target - x ];
+    }
+    if( target % 2 == 0 )
+    {
+        const uint64_t half = histogram[ target / 2 ];
+        total += ( half * ( half - 1 ) ) / 2;
+    }
+    return total;
+}
 
-extern "C" void count_pairs( unsigned int test_type )
+inline uint64_t test_case_4( const unsigned int* nums, const size_t count )
 {
-    // Copy the vector into an array and sequentially count the pairs in each.
-    // Eliminates the need to copy the vector on each iteration, thus taking
-    // the copy out of the perf hot path.
-    for( int i = 0; i < repititions; ++i )
+    // One pass with a hash map of the values seen so far: each new value pairs
+    // with every earlier ( target - value ).  O(n), any order.
+    std::unordered_map<unsigned int, uint64_t> seen;
+    seen.reserve( target + 1 );
+
+    uint64_t total = 0;
+    for( size_t i = 0; i < count; ++i )
+    {
+        const unsigned int value = nums[ i ];
+        if( value > target )
+        {
+            continue;
+        }
+
+        const auto match = seen.find( target - value );
+        if( match != seen.end() )
+        {
+            total += match->second;
+        }
+        ++seen[ value ];
+    }
+    return total;
+}
+
+inline uint64_t test_case_5( const unsigned int* nums, const size_t count )
+{
+    // Only values 0..target can be in a pair, so a tiny counting array covers
+    // everything.  Anything bigger goes in one overflow slot instead of a branch.
+    // Four copies of the array, used in turn: with one, back to back increments
+    // of the same slot (usually the overflow slot) wait on each other.
+    uint64_t histograms[ 4 ][ target + 2 ] = {};
+    size_t i = 0;
+    for( ; i + 4 <= count; i += 4 )
+    {
+        ++histograms[ 0 ][ std::min( nums[ i + 0 ], target + 1 ) ];
+        ++histograms[ 1 ][ std::min( nums[ i + 1 ], target + 1 ) ];
+        ++histograms[ 2 ][ std::min( nums[ i + 2 ], target + 1 ) ];
+        ++histograms[ 3 ][ std::min( nums[ i + 3 ], target + 1 ) ];
+    }
+    for( ; i < count; ++i )
+    {
+        ++histograms[ 0 ][ std::min( nums[ i ], target + 1 ) ];
+    }
+
+    for( unsigned int value = 0; value <= target; ++value )
+    {
+        histograms[ 0 ][ value ] += histograms[ 1 ][ value ] + histograms[ 2 ][ value ] + histograms[ 3 ][ value ];
+    }
+    return pairs_from_histogram( histograms[ 0 ] );
+}
+
+// Largest target the SIMD histogram keeps in registers.
+static const unsigned int MAX_SIMD_TARGET = 15;
+
+// Elements per SIMD block; keeps the 32 bit lane counters from overflowing.
+static const size_t SIMD_BLOCK = 1 << 24;
+
+inline uint64_t test_case_6( const unsigned int* nums, const size_t count )
+{
+    // Same counting as above, four elements at a time: compare against every
+    // value 0..target, and subtract the all-ones compare results from per-value
+    // lane counters.  Fine for small targets; beyond that, use the counting array.
+    if( target > MAX_SIMD_TARGET )
     {
-        test_cases[ i ].resize( nums.size() );
-        std::copy( nums.begin(), nums.end(), test_cases[ i ].begin() );
+        return test_case_5( nums, count );
     }
 
-    // Do some perf measurements.
-    // The functions get in-lined in an optimized build so there's no call
-    // overhead; the only non-algorithmic overhead is the loop counter logic.
+    uint64_t histogram[ MAX_SIMD_TARGET + 2 ] = {};
+    size_t i = 0;
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __aarch64__ )
+    while( count - i >= 4 )
+    {
+        const size_t block_end = i + std::min( ( count - i ) & ~static_cast<size_t>( 3 ), SIMD_BLOCK );
+        uint32_t lanes[ 4 ];
+
+    #if defined( __aarch64__ )
+        uint32x4_t counters[ target + 1 ];
+        for( unsigned int value = 0; value <= target; ++value )
+        {
+            counters[ value ] = vdupq_n_u32( 0 );
+        }
+        for( ; i < block_end; i += 4 )
+        {
+            const uint32x4_t x = vld1q_u32( nums + i );
+            for( unsigned int value = 0; value <= target; ++value )
+            {
+                counters[ value ] = vsubq_u32( counters[ value ], vceqq_u32( x, vdupq_n_u32( value ) ) );
+            }
+        }
+        for( unsigned int value = 0; value <= target; ++value )
+        {
+            vst1q_u32( lanes, counters[ value ] );
+            histogram[ value ] += static_cast<uint64_t>( lanes[ 0 ] ) + lanes[ 1 ] + lanes[ 2 ] + lanes[ 3 ];
+        }
+    #else
+        __m128i counters[ target + 1 ];
+        for( unsigned int value = 0; value <= target; ++value )
+        {
+            counters[ value ] = _mm_setzero_si128();
+        }
+        for( ; i < block_end; i += 4 )
+        {
+            const __m128i x = _mm_loadu_si128( reinterpret_cast<const __m128i*>( nums + i ) );
+            for( unsigned int value = 0; value <= target; ++value )
+            {
+                counters[ value ] = _mm_sub_epi32( counters[ value ], _mm_cmpeq_epi32( x, _mm_set1_epi32( static_cast<int>( value ) ) ) );
+            }
+        }
+        for( unsigned int value = 0; value <= target; ++value )
+        {
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( lanes ), counters[ value ] );
+            histogram[ value ] += static_cast<uint64_t>( lanes[ 0 ] ) + lanes[ 1 ] + lanes[ 2 ] + lanes[ 3 ];
+        }
+    #endif
+    }
+#endif
+
+    // Leftovers (or everything, without SIMD).
+    for( ; i < count; ++i )
+    {
+        ++histogram[ std::min( nums[ i ], target + 1 ) ];
+    }
+    return pairs_from_histogram( histogram );
+}
+
+// Values for the random inputs run over this many times target + 1, so about one
+// in RANDOM_VALUE_SPREAD of them is small enough to be in a pair and the counters do
+// real work rather than mostly rejecting values above target.
+static const unsigned int RANDOM_VALUE_SPREAD = 4;
+static const unsigned int RANDOM_VALUE_RANGE = RANDOM_VALUE_SPREAD * ( target + 1 );
+
+// Number of times each pass is repeated for min/median/max statistics.
+static const int REP_COUNT = 5;
+
+static long long TicksToNsec( long long ticks, long long freq )
+{
+    // Split to keep ticks * 10^9 from overflowing on long runs.
+    return ( ( ticks / freq ) * 1000000000LL ) + ( ( ( ticks % freq ) * 1000000000LL ) / freq );
+}
+
+// Print min/median/max statistics and the best ns per element for a labeled pass.
+static void PrintStats( const char *label, std::vector< long long > &nsecs, size_t elements, uint64_t total )
+{
+    std::sort( nsecs.begin(), nsecs.end() );
+    const long long minNs = nsecs.front();
+    const long long maxNs = nsecs.back();
+    const long long medNs = nsecs[ nsecs.size() / 2 ];
+    std::cout << label << ": min " << minNs / 1000
+              << " / med " << medNs / 1000
+              << " / max " << maxNs / 1000
+              << " usec, " << static_cast< double >( minNs ) / elements
+              << " ns/element (" << nsecs.size() << " reps) Total pairs that sum: " << total << "\n";
+}
+
+extern "C" void count_pairs_random( unsigned int element_count )
+{
+    std::mt19937 gen( 12345 );
+    std::uniform_int_distribution<unsigned int> distrib( 0, RANDOM_VALUE_RANGE - 1 );
+    std::vector<unsigned int> random_nums( element_count );
+    for( unsigned int& value : random_nums )
+    {
+        value = distrib( gen );
+    }
+
+    // test_case_3 needs sorted input; the sort isn't part of its time.
+    std::vector<unsigned int> sorted_nums( random_nums );
+    std::sort( sorted_nums.begin(), sorted_nums.end() );
+
+    const size_t candidates = std::count_if( random_nums.begin(), random_nums.end(), []( unsigned int value ) { return value <= target; } );
+    std::cout << "Random input, " << element_count << " elements in 0.." << ( RANDOM_VALUE_RANGE - 1 ) << ", "
+              << ( 100.0 * candidates / element_count ) << "% of them <= target:\n";
+
     LARGE_INTEGER freq, t0, t1;
     QueryPerformanceFrequency( &freq );
-    QueryPerformanceCounter( &t0 );
+    std::vector< long long > timings;
 
-    unsigned int total = 0;
-    switch( test_type )
+    uint64_t totals[ 4 ] = {};
+    for( int variant = 0; variant < 4; ++variant )
     {
-    case 0:
-        for( int i = 0; i < repititions; ++i )
+        timings.clear();
+        for( int rep = 0; rep < REP_COUNT; ++rep )
         {
-            total = 0;
-            test_case_0( test_cases[ i ], total );
+            QueryPerformanceCounter( &t0 );
+            switch( variant )
+            {
+            case 0:
+                totals[ variant ] = 0;
+                test_case_3( sorted_nums.data(), sorted_nums.data() + sorted_nums.size(), totals[ variant ] );
+                break;
+            case 1: totals[ variant ] = test_case_4( random_nums.data(), random_nums.size() ); break;
+            case 2: totals[ variant ] = test_case_5( random_nums.data(), random_nums.size() ); break;
+            case 3: totals[ variant ] = test_case_6( random_nums.data(), random_nums.size() ); break;
+            }
+            QueryPerformanceCounter( &t1 );
+            timings.push_back( TicksToNsec( t1.QuadPart - t0.QuadPart, freq.QuadPart ) );
         }
-        break;
 
-    case 1:
-        for( int i = 0; i < repititions; ++i )
+        static const char* names[] = { "  3 two pointer (sorted)", "  4 hash count          ", "  5 counting array      ", "  6 SIMD histogram      " };
+        PrintStats( names[ variant ], timings, element_count, totals[ variant ] );
+    }
+
+    for( int variant = 0; variant < 4; ++variant )
+    {
+        if( totals[ variant ] != totals[ 1 ] )
         {
-            total = 0;
-            test_case_1( test_cases[ i ], total );
+            std::cout << "  MISMATCH: variant " << ( variant + 3 ) << " total differs from the hash count\n";
         }
-        break;
+    }
+}
 
-    case 2:
+static const std::vector<unsigned int> nums = { 1, 1, 2, 2, 3, 3, 4, 5 };
+static const int repititions = 1000000;
+
+// All the repetitions back to back in one contiguous buffer, rather than a
+// separate heap allocation per repetition.
+std::vector<unsigned int> test_input;
+
+// Run a test case over every repetition's slice of test_input.  A template so the
+// test case still gets in-lined; the only non-algorithmic overhead is the loop.
+template< typename TestCase >
+inline unsigned int run_test_case( TestCase test_case )
+{
+    const size_t case_size = nums.size();
+    unsigned int* input = test_input.data();
+
+    unsigned int total = 0;
+    for( int i = 0; i < repititions; ++i )
+    {
+        total = 0;
+        test_case( input + ( i * case_size ), input + ( ( i + 1 ) * case_size ), total );
+    }
+    return total;
+}
+
+extern "C" void count_pairs( unsigned int test_type )
+{
+    const size_t case_size = nums.size();
+    test_input.resize( repititions * case_size );
+
+    LARGE_INTEGER freq, t0, t1;
+    QueryPerformanceFrequency( &freq );
+    std::vector< long long > timings;
+
+    unsigned int total = 0;
+    for( int rep = 0; rep < REP_COUNT; ++rep )
+    {
+        // The test cases consume their input, so lay down fresh copies of nums
+        // before each timed pass.  The copy is out of the perf hot path.
         for( int i = 0; i < repititions; ++i )
         {
-            total = 0;
-            test_case_2( test_cases[ i ], total );
+            std::copy( nums.begin(), nums.end(), test_input.begin() + ( i * case_size ) );
         }
-        break;
 
-    case 3:
-        for( int i = 0; i < repititions; ++i )
+        QueryPerformanceCounter( &t0 );
+        switch( test_type )
         {
-            total = 0;
-            test_case_3( test_cases[ i ], total );
+        case 0: total = run_test_case( []( unsigned int* b, unsigned int* e, unsigned int& t ) { test_case_0( b, e, t ); } ); break;
+        case 1: total = run_test_case( []( unsigned int* b, unsigned int* e, unsigned int& t ) { test_case_1( b, e, t ); } ); break;
+        case 2: total = run_test_case( []( unsigned int* b, unsigned int* e, unsigned int& t ) { test_case_2( b, e, t ); } ); break;
+        case 3: total = run_test_case( []( unsigned int* b, unsigned int* e, unsigned int& t ) { test_case_3( b, e, t ); } ); break;
         }
-        break;
+        QueryPerformanceCounter( &t1 );
+        timings.push_back( TicksToNsec( t1.QuadPart - t0.QuadPart, freq.QuadPart ) );
     }
 
-    QueryPerformanceCounter( &t1 );
-
-    std::cout << "usec: " << ( ( t1.QuadPart - t0.QuadPart ) * 1000000LL ) / freq.QuadPart;
-    std::cout << " Total pairs that sum: " << total << "\n";
+    char label[ 32 ];
+    snprintf( label, sizeof( label ), "test_case_%u", test_type );
+    PrintStats( label, timings, test_input.size(), total );
 }
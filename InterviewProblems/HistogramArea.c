@@ -1,5 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+
+#if !defined( __STDC_NO_THREADS__ )
+    #include <threads.h>
+#endif
+
+extern int cpu_count( void );   // SortLists.c
 
 void build_histogram( int** heights, int num_heights )
 {
@@ -10,37 +17,480 @@ void build_histogram( int** heights, int num_heights )
     }
 }
 
+// Stack of indices that grows as needed.  The stack only gets as deep as the longest
+// increasing run of heights, which for most inputs is far less than the input size.
+typedef struct
+{
+    size_t* items;
+    size_t  count;
+    size_t  capacity;
+} INDEX_STACK;
+
+static int stack_push( INDEX_STACK* stack, size_t index )
+{
+    if( stack->count == stack->capacity )
+    {
+        const size_t capacity = stack->capacity ? stack->capacity * 2 : 1024;
+        size_t* items = (size_t*)realloc( stack->items, capacity * sizeof(size_t) );
+        if( !items )
+        {
+            return 0;
+        }
+        stack->items = items;
+        stack->capacity = capacity;
+    }
+    stack->items[stack->count++] = index;
+    return 1;
+}
+
+static void stack_free( INDEX_STACK* stack )
+{
+    free( stack->items );
+    stack->items = NULL;
+    stack->count = 0;
+    stack->capacity = 0;
+}
+
+// The stack algorithm from find_largest_rectangle, over any array.  Heights must not
+// be negative.  The stack is left empty, but keeps its memory for the next call.
+// Returns -1 if out of memory.
+static long long histogram_kernel( const int* heights, size_t count, INDEX_STACK* stack )
+{
+    long long max_area = 0;
+    stack->count = 0;
+
+    for( size_t i = 0; i <= count; ++i )
+    {
+        int current_height = ( i == count ) ? 0 : heights[ i ];
+
+        while( stack->count > 0 && current_height < heights[ stack->items[ stack->count - 1 ] ] )
+        {
+            long long height = heights[ stack->items[ --stack->count ] ];
+            size_t width = ( stack->count == 0 ) ? i : ( i - stack->items[ stack->count - 1 ] - 1 );
+            max_area = ( height * (long long)width > max_area ) ? height * (long long)width : max_area;
+        }
+
+        if( i < count && !stack_push( stack, i ) )
+        {
+            return -1;
+        }
+    }
+    stack->count = 0;
+
+    return max_area;
+}
+
+// Area of the largest rectangle under the histogram heights[0..count).  Heights must
+// not be negative.  Returns -1 if out of memory.
+long long largest_rectangle( const int* heights, size_t count )
+{
+    INDEX_STACK stack = { NULL, 0, 0 };
+    const long long max_area = histogram_kernel( heights, count, &stack );
+    stack_free( &stack );
+    return max_area;
+}
+
+// Parallel version: split the heights into one chunk per thread and run the stack
+// algorithm on each chunk by itself.  A bar popped with another bar of the same
+// chunk still under it has both ends inside the chunk, so its area is final.  What
+// the chunk can't settle is left over in two lists:
+//   - minima: the chunk's prefix minima, the bars that found the stack empty.  Each
+//     one is popped by the next, but how far it reaches left depends on the chunks
+//     before.
+//   - residual: the stack at the end of the chunk, bars still reaching right.
+// Then, left to right over the chunks, a global stack replays each chunk's minima (the
+// only bars of the chunk that can pop bars of earlier chunks, and at exactly the
+// places the sequential algorithm would) and takes on its residual stack.  That is the
+// state the sequential algorithm would have reached, so popping what's left at the end
+// finishes the job.  The merge is proportional to the minima and residual stacks,
+// which are small unless the heights run in long increasing or decreasing stretches.
+typedef struct
+{
+    const int*  heights;
+    size_t      begin;
+    size_t      end;
+    long long   max_area;
+    INDEX_STACK minima;
+    INDEX_STACK residual;
+    int         ok;
+} HISTOGRAM_CHUNK;
+
+static int histogram_chunk_worker( void* arg )
+{
+    HISTOGRAM_CHUNK* chunk = (HISTOGRAM_CHUNK*)arg;
+    const int* heights = chunk->heights;
+    INDEX_STACK* stack = &chunk->residual;
+    long long max_area = 0;
+
+    for( size_t i = chunk->begin; i < chunk->end; ++i )
+    {
+        const int current_height = heights[ i ];
+
+        while( stack->count > 0 && current_height < heights[ stack->items[ stack->count - 1 ] ] )
+        {
+            long long height = heights[ stack->items[ --stack->count ] ];
+            if( stack->count > 0 )
+            {
+                size_t width = i - stack->items[ stack->count - 1 ] - 1;
+                max_area = ( height * (long long)width > max_area ) ? height * (long long)width : max_area;
+            }
+        }
+
+        if( ( stack->count == 0 && !stack_push( &chunk->minima, i ) ) || !stack_push( stack, i ) )
+        {
+            chunk->ok = 0;
+            return 0;
+        }
+    }
+
+    chunk->max_area = max_area;
+    chunk->ok = 1;
+    return 0;
+}
+
+// Pop every bar of stack taller than current_height, the way the sequential algorithm
+// does at index i.
+static long long pop_taller( const int* heights, INDEX_STACK* stack, int current_height, size_t i, long long max_area )
+{
+    while( stack->count > 0 && current_height < heights[ stack->items[ stack->count - 1 ] ] )
+    {
+        long long height = heights[ stack->items[ --stack->count ] ];
+        size_t width = ( stack->count == 0 ) ? i : ( i - stack->items[ stack->count - 1 ] - 1 );
+        max_area = ( height * (long long)width > max_area ) ? height * (long long)width : max_area;
+    }
+    return max_area;
+}
+
+#define MAX_HISTOGRAM_THREADS 64
+
+// Below this many heights per thread, starting threads costs more than it saves.
+#define MIN_HEIGHTS_PER_THREAD 65536
+
+// Same answer as largest_rectangle, using up to num_threads threads (0 for one per core).
+long long largest_rectangle_parallel( const int* heights, size_t count, int num_threads )
+{
+    if( num_threads <= 0 )
+    {
+        num_threads = cpu_count();
+    }
+    if( num_threads > MAX_HISTOGRAM_THREADS )
+    {
+        num_threads = MAX_HISTOGRAM_THREADS;
+    }
+    if( (size_t)num_threads > count / MIN_HEIGHTS_PER_THREAD )
+    {
+        num_threads = (int)( count / MIN_HEIGHTS_PER_THREAD );
+    }
+    if( num_threads <= 1 )
+    {
+        return largest_rectangle( heights, count );
+    }
+
+    HISTOGRAM_CHUNK chunks[MAX_HISTOGRAM_THREADS];
+    for( int c = 0; c < num_threads; ++c )
+    {
+        HISTOGRAM_CHUNK init = { heights, ( count * c ) / num_threads, ( count * ( c + 1 ) ) / num_threads, 0, { NULL, 0, 0 }, { NULL, 0, 0 }, 0 };
+        chunks[c] = init;
+    }
+
+#if !defined( __STDC_NO_THREADS__ )
+    // The calling thread takes the first chunk.
+    thrd_t threads[MAX_HISTOGRAM_THREADS];
+    int started[MAX_HISTOGRAM_THREADS] = { 0 };
+    for( int c = 1; c < num_threads; ++c )
+    {
+        started[c] = ( thrd_create( &threads[c], histogram_chunk_worker, &chunks[c] ) == thrd_success );
+    }
+    histogram_chunk_worker( &chunks[0] );
+    for( int c = 1; c < num_threads; ++c )
+    {
+        if( started[c] )
+        {
+            thrd_join( threads[c], NULL );
+        }
+        else
+        {
+            histogram_chunk_worker( &chunks[c] );
+        }
+    }
+#else
+    for( int c = 0; c < num_threads; ++c )
+    {
+        histogram_chunk_worker( &chunks[c] );
+    }
+#endif
+
+    long long max_area = 0;
+    int ok = 1;
+    INDEX_STACK stack = { NULL, 0, 0 };
+    for( int c = 0; c < num_threads && ok; ++c )
+    {
+        ok = chunks[c].ok;
+        max_area = ( chunks[c].max_area > max_area ) ? chunks[c].max_area : max_area;
+
+        for( size_t m = 0; m < chunks[c].minima.count && ok; ++m )
+        {
+            const size_t i = chunks[c].minima.items[m];
+            max_area = pop_taller( heights, &stack, heights[ i ], i, max_area );
+            ok = stack_push( &stack, i );
+        }
+
+        // The bottom of the residual stack is the last prefix minimum, already pushed.
+        for( size_t r = 1; r < chunks[c].residual.count && ok; ++r )
+        {
+            ok = stack_push( &stack, chunks[c].residual.items[r] );
+        }
+    }
+    if( ok )
+    {
+        max_area = pop_taller( heights, &stack, -1, count, max_area );
+    }
+
+    stack_free( &stack );
+    for( int c = 0; c < num_threads; ++c )
+    {
+        stack_free( &chunks[c].minima );
+        stack_free( &chunks[c].residual );
+    }
+
+    return ok ? max_area : -1;
+}
+
+// Largest all-ones rectangle in a rows x cols matrix of 0/1 cells (row major).  Row
+// by row, each column's height is the run of ones ending at that row, and the best
+// rectangle with its bottom edge on the row is the histogram answer for those heights.
+// Returns -1 if out of memory.
+long long largest_rectangle_in_matrix( const unsigned char* cells, size_t rows, size_t cols )
+{
+    int* heights = (int*)calloc( cols ? cols : 1, sizeof(int) );
+    INDEX_STACK stack = { NULL, 0, 0 };
+    if( !heights )
+    {
+        return -1;
+    }
+
+    long long max_area = 0;
+    for( size_t row = 0; row < rows && max_area >= 0; ++row )
+    {
+        const unsigned char* cell = &cells[ row * cols ];
+        for( size_t col = 0; col < cols; ++col )
+        {
+            heights[ col ] = cell[ col ] ? heights[ col ] + 1 : 0;
+        }
+
+        const long long area = histogram_kernel( heights, cols, &stack );
+        max_area = ( area < 0 || area > max_area ) ? area : max_area;
+    }
+
+    stack_free( &stack );
+    free( heights );
+    return max_area;
+}
+
 void find_largest_rectangle( void )
 {
     #define NUM_HEIGHTS 10
     int* heights;
     build_histogram( &heights, NUM_HEIGHTS );
 
-    int max_area = 0;
-    int* stack = (int*)malloc( NUM_HEIGHTS * sizeof(int) );
-    int top = -1;
+    long long max_area = largest_rectangle( heights, NUM_HEIGHTS );
 
-    for( int i = 0; i <= NUM_HEIGHTS; ++i )
+    for( int i = 0; i < NUM_HEIGHTS; ++i )
     {
-        int current_height = ( i == NUM_HEIGHTS ) ? 0 : heights[ i ];
+        printf( "%d ", heights[ i ] );
+    }
+    printf( "\n" );
+    free( heights );
+
+    printf( "Largest rectangle area: %lld\n", max_area );
+}
 
-        while( top >= 0 && current_height < heights[ stack[ top ] ] )
+static double histogram_seconds_now( void )
+{
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double)ts.tv_sec + ( ts.tv_nsec / 1e9 );
+}
+
+// xorshift, so the benchmark doesn't disturb rand() for the other samples.
+static unsigned int histogram_random( unsigned int* state )
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// O(n^2) answer for checking: for every left edge, extend right keeping the minimum.
+static long long largest_rectangle_brute( const int* heights, size_t count )
+{
+    long long max_area = 0;
+    for( size_t left = 0; left < count; ++left )
+    {
+        long long min_height = heights[ left ];
+        for( size_t right = left; right < count; ++right )
         {
-            int height = heights[ stack[ top-- ] ];
-            int width = ( top == -1 ) ? i : ( i - stack[ top ] - 1 );
-            max_area = ( height * width > max_area ) ? height * width : max_area;
+            min_height = ( heights[ right ] < min_height ) ? heights[ right ] : min_height;
+            const long long area = min_height * (long long)( right - left + 1 );
+            max_area = ( area > max_area ) ? area : max_area;
         }
+    }
+    return max_area;
+}
 
-        stack[ ++top ] = i;
+// O(r^2 c^2)-ish answer for checking: every top-left corner, growing down and right.
+static long long largest_rectangle_in_matrix_brute( const unsigned char* cells, size_t rows, size_t cols )
+{
+    long long max_area = 0;
+    for( size_t top = 0; top < rows; ++top )
+    {
+        for( size_t left = 0; left < cols; ++left )
+        {
+            size_t max_width = cols - left;
+            for( size_t bottom = top; bottom < rows && max_width > 0; ++bottom )
+            {
+                size_t width = 0;
+                while( width < max_width && cells[ bottom * cols + left + width ] )
+                {
+                    ++width;
+                }
+                max_width = width;
+                const long long area = (long long)( max_width * ( bottom - top + 1 ) );
+                max_area = ( area > max_area ) ? area : max_area;
+            }
+        }
     }
-    free( stack );
+    return max_area;
+}
 
-    for( int i = 0; i < NUM_HEIGHTS; ++i )
+// Sequential, parallel and brute force answers have to agree, on random heights and on
+// the shapes that stress the merge: one long increasing run (every bar stays on the
+// stack), decreasing (every bar is a prefix minimum), all equal, and a valley.
+static int verify_histogram( void )
+{
+    #define CHECK_SIZE 200000
+    #define BRUTE_SIZE 2000
+    int* heights = (int*)malloc( CHECK_SIZE * sizeof(int) );
+    if( !heights )
     {
-        printf( "%d ", heights[ i ] );
+        return 0;
+    }
+
+    unsigned int state = 12345;
+    int failures = 0;
+    for( int shape = 0; shape < 5; ++shape )
+    {
+        for( size_t i = 0; i < CHECK_SIZE; ++i )
+        {
+            const int mid = CHECK_SIZE / 2;
+            switch( shape )
+            {
+                case 0: heights[ i ] = (int)( histogram_random( &state ) % 1000 ); break;
+                case 1: heights[ i ] = (int)i + 1; break;
+                case 2: heights[ i ] = CHECK_SIZE - (int)i; break;
+                case 3: heights[ i ] = 7; break;
+                default: heights[ i ] = ( (int)i < mid ) ? mid - (int)i : (int)i - mid; break;
+            }
+        }
+
+        const long long expected = largest_rectangle( heights, CHECK_SIZE );
+        for( int threads = 2; threads <= 3; ++threads )
+        {
+            // Go below MIN_HEIGHTS_PER_THREAD so small inputs still get split.
+            const long long area = largest_rectangle_parallel( heights, CHECK_SIZE, threads );
+            if( area != expected )
+            {
+                printf( "  shape %d, %d threads: %lld, expected %lld\n", shape, threads, area, expected );
+                ++failures;
+            }
+        }
+        if( largest_rectangle( heights, BRUTE_SIZE ) != largest_rectangle_brute( heights, BRUTE_SIZE ) )
+        {
+            printf( "  shape %d: stack and brute force disagree\n", shape );
+            ++failures;
+        }
     }
-    printf( "\n" );
     free( heights );
 
-    printf( "Largest rectangle area: %d\n", max_area );
-}
\ No newline at end of file
+    #define CHECK_ROWS 24
+    #define CHECK_COLS 31
+    unsigned char cells[ CHECK_ROWS * CHECK_COLS ];
+    for( int density = 50; density <= 95; density += 15 )
+    {
+        for( int i = 0; i < CHECK_ROWS * CHECK_COLS; ++i )
+        {
+            cells[ i ] = ( histogram_random( &state ) % 100 ) < (unsigned)density;
+        }
+        if( largest_rectangle_in_matrix( cells, CHECK_ROWS, CHECK_COLS ) != largest_rectangle_in_matrix_brute( cells, CHECK_ROWS, CHECK_COLS ) )
+        {
+            printf( "  matrix, %d%% ones: stack and brute force disagree\n", density );
+            ++failures;
+        }
+    }
+
+    return failures == 0;
+}
+
+void largest_rectangle_benchmark( void )
+{
+    #define BENCH_HEIGHTS 100000000
+    #define BENCH_MAX_HEIGHT 1000000
+    #define BENCH_ROWS 4096
+    #define BENCH_COLS 4096
+
+    printf( "Largest rectangle self-check: %s\n", verify_histogram() ? "ok" : "FAILED" );
+
+    int* heights = (int*)malloc( (size_t)BENCH_HEIGHTS * sizeof(int) );
+    if( !heights )
+    {
+        return;
+    }
+    unsigned int state = 42;
+    for( size_t i = 0; i < BENCH_HEIGHTS; ++i )
+    {
+        heights[ i ] = (int)( histogram_random( &state ) % BENCH_MAX_HEIGHT );
+    }
+
+    const int cores = cpu_count();
+    printf( "Largest rectangle, %d random heights (%d cores)\n", BENCH_HEIGHTS, cores );
+    printf( "%-20s %14s %10s %10s\n", "method", "area", "ms", "M/s" );
+
+    double start = histogram_seconds_now();
+    const long long expected = largest_rectangle( heights, BENCH_HEIGHTS );
+    double elapsed = histogram_seconds_now() - start;
+    printf( "%-20s %14lld %10.1f %10.1f\n", "sequential", expected, elapsed * 1e3, BENCH_HEIGHTS / elapsed / 1e6 );
+
+    int thread_counts[] = { 2, 4, cores };
+    for( int t = 0; t < (int)( sizeof( thread_counts ) / sizeof( thread_counts[0] ) ); ++t )
+    {
+        if( t == 2 && ( cores <= 2 || cores == 4 ) )
+        {
+            continue;
+        }
+        char label[32];
+        snprintf( label, sizeof( label ), "parallel, %d threads", thread_counts[t] );
+
+        start = histogram_seconds_now();
+        const long long area = largest_rectangle_parallel( heights, BENCH_HEIGHTS, thread_counts[t] );
+        elapsed = histogram_seconds_now() - start;
+        printf( "%-20s %14lld %10.1f %10.1f%s\n", label, area, elapsed * 1e3, BENCH_HEIGHTS / elapsed / 1e6, ( area == expected ) ? "" : "  MISMATCH" );
+    }
+    free( heights );
+
+    // 90% ones, so rectangles a few cells across turn up everywhere.
+    unsigned char* cells = (unsigned char*)malloc( (size_t)BENCH_ROWS * BENCH_COLS );
+    if( !cells )
+    {
+        return;
+    }
+    for( size_t i = 0; i < (size_t)BENCH_ROWS * BENCH_COLS; ++i )
+    {
+        cells[ i ] = ( histogram_random( &state ) % 10 ) != 0;
+    }
+    start = histogram_seconds_now();
+    const long long area = largest_rectangle_in_matrix( cells, BENCH_ROWS, BENCH_COLS );
+    elapsed = histogram_seconds_now() - start;
+    printf( "%-20s %14lld %10.1f %10.1f  (%dx%d matrix, M cells/s)\n", "binary matrix", area, elapsed * 1e3,
+            (double)BENCH_ROWS * BENCH_COLS / elapsed / 1e6, BENCH_ROWS, BENCH_COLS );
+    free( cells );
+}
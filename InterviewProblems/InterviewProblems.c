@@ -1,17 +1,44 @@
+#include <string.h>
+
 extern void sort_lists( void );
+extern void sort_lists_benchmark( void );
+extern void list_layout_benchmark( void );
 extern void find_largest_rectangle( void );
+extern void largest_rectangle_benchmark( void );
 extern void count_pairs( unsigned int );
+extern void count_pairs_random( unsigned int );
 
-int main()
+int main( int argc, char* argv[] )
 {
+    // The demos always run.  "bench" adds the benchmarks, which take minutes and
+    // several GB: 10^7 node merges, 2 * 10^7 node layouts, 10^8 heights and a 4096^2
+    // matrix, and random pair inputs up to 10^8 elements.
+    const int bench = ( argc > 1 && strcmp( argv[1], "bench" ) == 0 );
+
     sort_lists();
+    if( bench )
+    {
+        sort_lists_benchmark();
+        list_layout_benchmark();
+    }
 
     find_largest_rectangle();
+    if( bench )
+    {
+        largest_rectangle_benchmark();
+    }
 
     count_pairs( 0 );
     count_pairs( 1 );
     count_pairs( 2 );
     count_pairs( 3 );
 
+    count_pairs_random( 1000000 );
+    if( bench )
+    {
+        count_pairs_random( 10000000 );
+        count_pairs_random( 100000000 );
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -1,6 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <time.h>
+
+#if !defined( __STDC_NO_THREADS__ )
+    #include <threads.h>
+#endif
+
+#if defined( _WIN32 )
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
 
 typedef struct _LL_NODE
 {
@@ -135,6 +147,166 @@ void create_random_lists( LL_NODE** lists, int num_lists, int num_nodes_per_list
     lists[num_lists - 1] = nodes; // The remaining nodes go into the last list
 }
 
+// Node pool: every node comes out of one big allocation instead of a malloc
+// each.  Nodes handed back go on a free list (chained through next) and are
+// reused first.  node_pool_reset() recycles the whole pool at once.
+typedef struct
+{
+    LL_NODE* nodes;
+    int      capacity;
+    int      used;
+    LL_NODE* free_list;
+} NODE_POOL;
+
+int node_pool_init( NODE_POOL* pool, int capacity )
+{
+    pool->nodes = (LL_NODE*)malloc( (size_t)capacity * sizeof(LL_NODE) );
+    pool->capacity = pool->nodes ? capacity : 0;
+    pool->used = 0;
+    pool->free_list = NULL;
+    return pool->nodes != NULL;
+}
+
+void node_pool_reset( NODE_POOL* pool )
+{
+    pool->used = 0;
+    pool->free_list = NULL;
+}
+
+void node_pool_destroy( NODE_POOL* pool )
+{
+    free( pool->nodes );
+    pool->nodes = NULL;
+    pool->capacity = 0;
+    node_pool_reset( pool );
+}
+
+LL_NODE* pool_create_node( NODE_POOL* pool, int value )
+{
+    LL_NODE* node = pool->free_list;
+    if( node != NULL )
+    {
+        pool->free_list = node->next;
+    }
+    else if( pool->used < pool->capacity )
+    {
+        node = &pool->nodes[pool->used++];
+    }
+    else
+    {
+        return NULL;
+    }
+
+    node->value = value;
+    node->next = NULL;
+    node->prev = NULL;
+    return node;
+}
+
+void pool_free_node( NODE_POOL* pool, LL_NODE* node )
+{
+    node->next = pool->free_list;
+    pool->free_list = node;
+}
+
+// count contiguous, uninitialized nodes, or NULL if the pool is out of room.
+LL_NODE* pool_alloc_block( NODE_POOL* pool, int count )
+{
+    if( count > pool->capacity - pool->used )
+    {
+        return NULL;
+    }
+    LL_NODE* block = &pool->nodes[pool->used];
+    pool->used += count;
+    return block;
+}
+
+// owner[v] says which list gets value v + 1: num_nodes_per_list copies of each list
+// number, Fisher-Yates shuffled.  Handing out values in increasing order then
+// builds every list sorted just by appending.  NULL if out of memory; free() it.
+static int* shuffle_list_owners( int num_lists, int num_nodes_per_list, unsigned int seed )
+{
+    const int node_count = num_lists * num_nodes_per_list;
+    int* owner = (int*)malloc( (size_t)node_count * sizeof(int) );
+    if( !owner )
+    {
+        return NULL;
+    }
+
+    for( int v = 0; v < node_count; ++v )
+    {
+        owner[v] = v / num_nodes_per_list;
+    }
+
+    // xorshift: rand() only guarantees 15 bits, too few for millions of nodes.
+    unsigned int random = seed ? seed : 1;
+    for( int i = node_count - 1; i > 0; --i )
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        const int j = (int)( random % (unsigned)( i + 1 ) );
+        const int swap = owner[i];
+        owner[i] = owner[j];
+        owner[j] = swap;
+    }
+    return owner;
+}
+
+// O(N) version of create_random_lists: the same thing (values 1..N, each list
+// num_nodes_per_list of them at random, in sorted order) without walking the
+// master list for every node.  See shuffle_list_owners.
+// Each list's nodes sit together in one block from the pool, in list order, so
+// walking a list is a walk through memory but merging hops between lists.
+// With scattered set, nodes go to random slots in the block instead, the way
+// they end up after a long run of mallocs and frees.
+// seed picks the shuffle.  Returns 0 if memory runs out.
+int create_random_lists_pooled( NODE_POOL* pool, LL_NODE** lists, int num_lists, int num_nodes_per_list, unsigned int seed, int scattered )
+{
+    const int node_count = num_lists * num_nodes_per_list;
+    LL_NODE* block = pool_alloc_block( pool, node_count );
+    int* owner = shuffle_list_owners( num_lists, num_nodes_per_list, seed );
+    int* filled = (int*)calloc( num_lists, sizeof(int) );
+    // With one node per "list", the owners are just a random permutation of the slots.
+    int* slots = scattered ? shuffle_list_owners( node_count, 1, seed + 1 ) : NULL;
+    if( !block || !owner || !filled || ( scattered && !slots ) )
+    {
+        free( owner );
+        free( filled );
+        free( slots );
+        return 0;
+    }
+
+    for( int i = 0; i < num_lists; ++i )
+    {
+        lists[i] = NULL;
+    }
+    for( int v = 0; v < node_count; ++v )
+    {
+        const int list = owner[v];
+        const int slot = ( list * num_nodes_per_list ) + filled[list];
+        LL_NODE* node = &block[scattered ? slots[slot] : slot];
+        node->value = v + 1;
+        node->next = NULL;
+        if( filled[list] > 0 )
+        {
+            node->prev = &block[scattered ? slots[slot - 1] : slot - 1];
+            node->prev->next = node;
+        }
+        else
+        {
+            node->prev = NULL;
+            lists[list] = node;
+        }
+        ++filled[list];
+    }
+
+    free( owner );
+    free( filled );
+    free( slots );
+    return 1;
+}
+
 LL_NODE* merge_and_sort_lists( LL_NODE** lists, int num_lists )
 {
     // This function should merge the linked lists and sort the resulting list.
@@ -201,6 +373,948 @@ LL_NODE* merge_and_sort_lists( LL_NODE** lists, int num_lists )
     return merged_head;
 }
 
+// Append node to the list ending at *tail.
+static void append_node( LL_NODE** head, LL_NODE** tail, LL_NODE* node )
+{
+    node->prev = *tail;
+    node->next = NULL;
+    if( *tail != NULL )
+    {
+        (*tail)->next = node;
+    }
+    else
+    {
+        *head = node;
+    }
+    *tail = node;
+}
+
+// Restore the heap below slot index; the heap is ordered by node value.
+static void sift_down( LL_NODE** heap, int count, int index )
+{
+    LL_NODE* node = heap[index];
+    while( 1 )
+    {
+        int child = ( 2 * index ) + 1;
+        if( child >= count )
+            break;
+
+        if( child + 1 < count && heap[child + 1]->value < heap[child]->value )
+        {
+            ++child;
+        }
+        if( heap[child]->value >= node->value )
+            break;
+
+        heap[index] = heap[child];
+        index = child;
+    }
+    heap[index] = node;
+}
+
+// Same result as merge_and_sort_lists, in O(N log k) instead of O(N k).
+// A binary min-heap holds the current head of every list.  The top of the heap is
+// the next node out; its successor replaces it at the top and sinks to its place.
+LL_NODE* merge_lists_heap( LL_NODE** lists, int num_lists )
+{
+    LL_NODE* merged_head = NULL;
+    LL_NODE* merged_tail = NULL;
+
+    LL_NODE** heap = (LL_NODE**)malloc( num_lists * sizeof(LL_NODE*) );
+    if( !heap )
+    {
+        return NULL;
+    }
+
+    int count = 0;
+    for( int i = 0; i < num_lists; ++i )
+    {
+        if( lists[i] != NULL )
+        {
+            heap[count++] = lists[i];
+        }
+    }
+    for( int i = ( count / 2 ) - 1; i >= 0; --i )
+    {
+        sift_down( heap, count, i );
+    }
+
+    while( count > 0 )
+    {
+        LL_NODE* min_node = heap[0];
+        if( min_node->next != NULL )
+        {
+            heap[0] = min_node->next;
+        }
+        else
+        {
+            heap[0] = heap[--count];
+        }
+        if( count > 0 )
+        {
+            sift_down( heap, count, 0 );
+        }
+
+        append_node( &merged_head, &merged_tail, min_node );
+    }
+
+    free( heap );
+
+    return merged_head;
+}
+
+// Classic two-way merge of sorted lists a and b.
+static LL_NODE* merge_two_lists( LL_NODE* a, LL_NODE* b )
+{
+    LL_NODE* merged_head = NULL;
+    LL_NODE* merged_tail = NULL;
+
+    while( a != NULL && b != NULL )
+    {
+        LL_NODE* next;
+        if( a->value <= b->value )
+        {
+            next = a;
+            a = a->next;
+        }
+        else
+        {
+            next = b;
+            b = b->next;
+        }
+        append_node( &merged_head, &merged_tail, next );
+    }
+
+    // Whatever is left is already sorted and linked; just hook it on.
+    LL_NODE* rest = ( a != NULL ) ? a : b;
+    if( rest != NULL )
+    {
+        rest->prev = merged_tail;
+        if( merged_tail != NULL )
+        {
+            merged_tail->next = rest;
+        }
+        else
+        {
+            merged_head = rest;
+        }
+    }
+
+    return merged_head;
+}
+
+typedef struct
+{
+    LL_NODE** input;
+    LL_NODE** output;
+    int       num_pairs;
+    int       first_pair;
+    int       pair_step;
+} MERGE_ROUND;
+
+// Merge pairs first_pair, first_pair + pair_step, ... of one round:
+// input[2p] and input[2p + 1] into output[p].
+static int merge_round_worker( void* arg )
+{
+    MERGE_ROUND* round = (MERGE_ROUND*)arg;
+    for( int pair = round->first_pair; pair < round->num_pairs; pair += round->pair_step )
+    {
+        round->output[pair] = merge_two_lists( round->input[2 * pair], round->input[( 2 * pair ) + 1] );
+    }
+    return 0;
+}
+
+int cpu_count( void )
+{
+#if defined( _WIN32 )
+    SYSTEM_INFO info;
+    GetSystemInfo( &info );
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf( _SC_NPROCESSORS_ONLN );
+    return ( count > 0 ) ? (int)count : 1;
+#endif
+}
+
+#define MAX_MERGE_THREADS 64
+
+// Merge the lists pairwise, like a tournament bracket: k lists become k/2, then
+// k/4, ... until one is left.  Each round touches every node once, so the total
+// is O(N log k), and the merges within a round are independent, so they're split
+// across num_threads threads.  The last rounds have fewer pairs than threads (the
+// final round is a single merge), so the speedup tails off at the top of the tree.
+// Each round reads one array and writes another, since pair p's output slot is an
+// input of pair p/2, which may be on another thread; lists is one of the two.
+LL_NODE* merge_lists_pairwise( LL_NODE** lists, int num_lists, int num_threads )
+{
+    if( num_lists <= 0 )
+    {
+        return NULL;
+    }
+    if( num_threads < 1 )
+    {
+        num_threads = 1;
+    }
+    if( num_threads > MAX_MERGE_THREADS )
+    {
+        num_threads = MAX_MERGE_THREADS;
+    }
+
+    LL_NODE** scratch = (LL_NODE**)malloc( ( ( num_lists + 1 ) / 2 ) * sizeof(LL_NODE*) );
+    if( scratch == NULL )
+    {
+        // One thread in ascending order can merge in place: pair p writes lists[p]
+        // after every pair that reads it.
+        scratch = lists;
+        num_threads = 1;
+    }
+
+    LL_NODE** input = lists;
+    LL_NODE** output = scratch;
+    int count = num_lists;
+    while( count > 1 )
+    {
+        const int num_pairs = count / 2;
+        const int round_threads = ( num_pairs < num_threads ) ? num_pairs : num_threads;
+
+        MERGE_ROUND rounds[MAX_MERGE_THREADS];
+        for( int t = 0; t < round_threads; ++t )
+        {
+            rounds[t].input = input;
+            rounds[t].output = output;
+            rounds[t].num_pairs = num_pairs;
+            rounds[t].first_pair = t;
+            rounds[t].pair_step = round_threads;
+        }
+
+#if !defined( __STDC_NO_THREADS__ )
+        thrd_t threads[MAX_MERGE_THREADS];
+        int started = 1;
+        for( int t = 1; t < round_threads; ++t )
+        {
+            if( thrd_create( &threads[t], merge_round_worker, &rounds[t] ) != thrd_success )
+                break;
+            ++started;
+        }
+        merge_round_worker( &rounds[0] );
+        for( int t = 1; t < started; ++t )
+        {
+            thrd_join( threads[t], NULL );
+        }
+        // Anything that didn't get a thread runs here.
+        for( int t = started; t < round_threads; ++t )
+        {
+            merge_round_worker( &rounds[t] );
+        }
+#else
+        for( int t = 0; t < round_threads; ++t )
+        {
+            merge_round_worker( &rounds[t] );
+        }
+#endif
+
+        // An odd list out moves up to the next round unmerged.
+        if( count % 2 )
+        {
+            output[num_pairs] = input[count - 1];
+        }
+        count = num_pairs + ( count % 2 );
+
+        LL_NODE** swap = input;
+        input = output;
+        output = swap;
+    }
+
+    LL_NODE* merged = input[0];
+    if( scratch != lists )
+    {
+        free( scratch );
+    }
+    return merged;
+}
+
+// Two other ways to lay out the same lists, to see what the pointer chasing costs.
+//
+// Array-backed list: every node of every list lives in one array, linked by index.
+// A node is 8 bytes instead of LL_NODE's 24 (singly linked, 32 bit links), so more
+// of them share a cache line, and the array is one allocation.
+#define ALIST_END -1
+
+typedef struct
+{
+    int value;
+    int next;   // index of the next node in the array, or ALIST_END
+} ALIST_NODE;
+
+// Unrolled list: each node carries a short array of values, sized so the node is one
+// 64 byte cache line (with 8 byte pointers).  Walking the list touches one line per
+// UNROLLED_VALUES values instead of one per value.
+#define UNROLLED_VALUES 13
+
+typedef struct _UL_NODE
+{
+    struct _UL_NODE* next;
+    int              count;
+    int              values[UNROLLED_VALUES];
+} UL_NODE;
+
+typedef struct
+{
+    UL_NODE* nodes;
+    int      capacity;
+    int      used;
+} UL_POOL;
+
+static int ul_nodes_for( int num_values )
+{
+    return ( num_values + UNROLLED_VALUES - 1 ) / UNROLLED_VALUES;
+}
+
+static UL_NODE* ul_pool_create_node( UL_POOL* pool )
+{
+    if( pool->used == pool->capacity )
+    {
+        return NULL;
+    }
+    UL_NODE* node = &pool->nodes[pool->used++];
+    node->next = NULL;
+    node->count = 0;
+    return node;
+}
+
+// Append value to the list ending at *tail, starting a new node when that one is full.
+static int ul_append( UL_POOL* pool, UL_NODE** head, UL_NODE** tail, int value )
+{
+    if( *tail == NULL || (*tail)->count == UNROLLED_VALUES )
+    {
+        UL_NODE* node = ul_pool_create_node( pool );
+        if( !node )
+        {
+            return 0;
+        }
+        if( *tail != NULL )
+        {
+            (*tail)->next = node;
+        }
+        else
+        {
+            *head = node;
+        }
+        *tail = node;
+    }
+    (*tail)->values[(*tail)->count++] = value;
+    return 1;
+}
+
+// Same lists as create_random_lists_pooled (same seed, same values in each list),
+// as index-linked nodes in nodes[], with each list's nodes together.
+// heads[] gets each list's first node index.
+int create_random_alists( ALIST_NODE* nodes, int* heads, int num_lists, int num_nodes_per_list, unsigned int seed )
+{
+    const int node_count = num_lists * num_nodes_per_list;
+    int* owner = shuffle_list_owners( num_lists, num_nodes_per_list, seed );
+    int* filled = (int*)calloc( num_lists, sizeof(int) );
+    if( !owner || !filled )
+    {
+        free( owner );
+        free( filled );
+        return 0;
+    }
+
+    for( int i = 0; i < num_lists; ++i )
+    {
+        heads[i] = ALIST_END;
+    }
+    for( int v = 0; v < node_count; ++v )
+    {
+        const int list = owner[v];
+        const int index = ( list * num_nodes_per_list ) + filled[list];
+        nodes[index].value = v + 1;
+        nodes[index].next = ALIST_END;
+        if( filled[list] > 0 )
+        {
+            nodes[index - 1].next = index;
+        }
+        else
+        {
+            heads[list] = index;
+        }
+        ++filled[list];
+    }
+
+    free( owner );
+    free( filled );
+    return 1;
+}
+
+// Same lists again, unrolled.  The pool needs ul_nodes_for( num_nodes_per_list )
+// nodes per list; each list's nodes are taken together.
+int create_random_ulists( UL_POOL* pool, UL_NODE** lists, int num_lists, int num_nodes_per_list, unsigned int seed )
+{
+    const int node_count = num_lists * num_nodes_per_list;
+    const int list_nodes = ul_nodes_for( num_nodes_per_list );
+    int* owner = shuffle_list_owners( num_lists, num_nodes_per_list, seed );
+    int* filled = (int*)calloc( num_lists, sizeof(int) );
+    if( !owner || !filled || pool->capacity - pool->used < num_lists * list_nodes )
+    {
+        free( owner );
+        free( filled );
+        return 0;
+    }
+
+    UL_NODE* block = &pool->nodes[pool->used];
+    pool->used += num_lists * list_nodes;
+    for( int i = 0; i < num_lists; ++i )
+    {
+        lists[i] = NULL;
+    }
+    for( int v = 0; v < node_count; ++v )
+    {
+        const int list = owner[v];
+        UL_NODE* node = &block[( list * list_nodes ) + ( filled[list] / UNROLLED_VALUES )];
+        const int slot = filled[list] % UNROLLED_VALUES;
+        if( slot == 0 )
+        {
+            node->next = NULL;
+            node->count = 0;
+            if( filled[list] > 0 )
+            {
+                ( node - 1 )->next = node;
+            }
+            else
+            {
+                lists[list] = node;
+            }
+        }
+        node->values[slot] = v + 1;
+        node->count = slot + 1;
+        ++filled[list];
+    }
+
+    free( owner );
+    free( filled );
+    return 1;
+}
+
+// sift_down for a heap of node indices.
+static void sift_down_alist( int* heap, int count, int index, const ALIST_NODE* nodes )
+{
+    const int node = heap[index];
+    while( 1 )
+    {
+        int child = ( 2 * index ) + 1;
+        if( child >= count )
+            break;
+
+        if( child + 1 < count && nodes[heap[child + 1]].value < nodes[heap[child]].value )
+        {
+            ++child;
+        }
+        if( nodes[heap[child]].value >= nodes[node].value )
+            break;
+
+        heap[index] = heap[child];
+        index = child;
+    }
+    heap[index] = node;
+}
+
+// merge_lists_heap for index-linked lists: the heap holds node indices, and the
+// merged list is linked through the same nodes.  Returns the merged head index.
+int merge_alists_heap( ALIST_NODE* nodes, const int* heads, int num_lists )
+{
+    int merged_head = ALIST_END;
+    int merged_tail = ALIST_END;
+
+    int* heap = (int*)malloc( num_lists * sizeof(int) );
+    if( !heap )
+    {
+        return ALIST_END;
+    }
+
+    int count = 0;
+    for( int i = 0; i < num_lists; ++i )
+    {
+        if( heads[i] != ALIST_END )
+        {
+            heap[count++] = heads[i];
+        }
+    }
+    for( int i = ( count / 2 ) - 1; i >= 0; --i )
+    {
+        sift_down_alist( heap, count, i, nodes );
+    }
+
+    while( count > 0 )
+    {
+        const int min_node = heap[0];
+        if( nodes[min_node].next != ALIST_END )
+        {
+            heap[0] = nodes[min_node].next;
+        }
+        else
+        {
+            heap[0] = heap[--count];
+        }
+        if( count > 0 )
+        {
+            sift_down_alist( heap, count, 0, nodes );
+        }
+
+        nodes[min_node].next = ALIST_END;
+        if( merged_tail != ALIST_END )
+        {
+            nodes[merged_tail].next = min_node;
+        }
+        else
+        {
+            merged_head = min_node;
+        }
+        merged_tail = min_node;
+    }
+
+    free( heap );
+
+    return merged_head;
+}
+
+// Where a merge is up to in one unrolled list.
+typedef struct
+{
+    const UL_NODE* node;
+    int            position;
+} UL_CURSOR;
+
+static int ul_cursor_value( const UL_CURSOR* cursor )
+{
+    return cursor->node->values[cursor->position];
+}
+
+// sift_down for a heap of unrolled list cursors.
+static void sift_down_ulist( UL_CURSOR* heap, int count, int index )
+{
+    const UL_CURSOR cursor = heap[index];
+    const int value = ul_cursor_value( &cursor );
+    while( 1 )
+    {
+        int child = ( 2 * index ) + 1;
+        if( child >= count )
+            break;
+
+        if( child + 1 < count && ul_cursor_value( &heap[child + 1] ) < ul_cursor_value( &heap[child] ) )
+        {
+            ++child;
+        }
+        if( ul_cursor_value( &heap[child] ) >= value )
+            break;
+
+        heap[index] = heap[child];
+        index = child;
+    }
+    heap[index] = cursor;
+}
+
+// merge_lists_heap for unrolled lists.  Values can't be relinked one at a time, so
+// the merged list is new nodes from out (which needs ul_nodes_for( total values )
+// of them); the input lists are left alone.
+UL_NODE* merge_ulists_heap( UL_NODE** lists, int num_lists, UL_POOL* out )
+{
+    UL_NODE* merged_head = NULL;
+    UL_NODE* merged_tail = NULL;
+
+    UL_CURSOR* heap = (UL_CURSOR*)malloc( num_lists * sizeof(UL_CURSOR) );
+    if( !heap )
+    {
+        return NULL;
+    }
+
+    int count = 0;
+    for( int i = 0; i < num_lists; ++i )
+    {
+        if( lists[i] != NULL && lists[i]->count > 0 )
+        {
+            heap[count].node = lists[i];
+            heap[count].position = 0;
+            ++count;
+        }
+    }
+    for( int i = ( count / 2 ) - 1; i >= 0; --i )
+    {
+        sift_down_ulist( heap, count, i );
+    }
+
+    while( count > 0 )
+    {
+        if( !ul_append( out, &merged_head, &merged_tail, ul_cursor_value( &heap[0] ) ) )
+        {
+            break;
+        }
+
+        UL_CURSOR* top = &heap[0];
+        if( ++top->position == top->node->count )
+        {
+            top->node = top->node->next;
+            top->position = 0;
+        }
+        if( top->node == NULL || top->node->count == 0 )
+        {
+            heap[0] = heap[--count];
+        }
+        if( count > 0 )
+        {
+            sift_down_ulist( heap, count, 0 );
+        }
+    }
+
+    free( heap );
+
+    return merged_head;
+}
+
+static double seconds_now( void )
+{
+    struct timespec ts;
+    timespec_get( &ts, TIME_UTC );
+    return (double)ts.tv_sec + ( ts.tv_nsec / 1e9 );
+}
+
+// Check the merge: num_nodes nodes, values 1..num_nodes in order, prev links consistent.
+static int check_merged( LL_NODE* merged, int num_nodes )
+{
+    int ok = 1;
+    int count = 0;
+    LL_NODE* prev = NULL;
+    while( merged != NULL )
+    {
+        ++count;
+        if( merged->prev != prev || merged->value != count )
+        {
+            ok = 0;
+        }
+        prev = merged;
+        merged = merged->next;
+    }
+    return ok && ( count == num_nodes );
+}
+
+static int check_merged_alist( const ALIST_NODE* nodes, int head, int num_nodes )
+{
+    int ok = 1;
+    int count = 0;
+    for( int index = head; index != ALIST_END; index = nodes[index].next )
+    {
+        ++count;
+        if( nodes[index].value != count )
+        {
+            ok = 0;
+        }
+    }
+    return ok && ( count == num_nodes );
+}
+
+static int check_merged_ulist( const UL_NODE* merged, int num_nodes )
+{
+    int ok = 1;
+    int count = 0;
+    for( ; merged != NULL; merged = merged->next )
+    {
+        for( int i = 0; i < merged->count; ++i )
+        {
+            ++count;
+            if( merged->values[i] != count )
+            {
+                ok = 0;
+            }
+        }
+    }
+    return ok && ( count == num_nodes );
+}
+
+typedef LL_NODE* ( *MERGE_FUNC )( LL_NODE** lists, int num_lists, int num_threads );
+
+static LL_NODE* merge_linear_adapter( LL_NODE** lists, int num_lists, int num_threads )
+{
+    (void)num_threads;
+    return merge_and_sort_lists( lists, num_lists );
+}
+
+static LL_NODE* merge_heap_adapter( LL_NODE** lists, int num_lists, int num_threads )
+{
+    (void)num_threads;
+    return merge_lists_heap( lists, num_lists );
+}
+
+// The pairwise merge with several threads against small inputs, odd list counts
+// included.  Threads are asked for explicitly, so this runs on one core too.
+static int verify_pairwise_merge( void )
+{
+    static const int list_counts[] = { 1, 2, 3, 7, 64, 1000, 1025 };
+    static const int nodes_per_list[] = { 1, 5 };
+    static const int thread_counts[] = { 1, 2, 3, 8 };
+
+    NODE_POOL pool;
+    LL_NODE** lists = (LL_NODE**)malloc( 1025 * sizeof(LL_NODE*) );
+    if( !lists || !node_pool_init( &pool, 1025 * 5 ) )
+    {
+        free( lists );
+        return 0;
+    }
+
+    int ok = 1;
+    for( int l = 0; l < (int)( sizeof( list_counts ) / sizeof( list_counts[0] ) ); ++l )
+    {
+        for( int n = 0; n < (int)( sizeof( nodes_per_list ) / sizeof( nodes_per_list[0] ) ); ++n )
+        {
+            for( int t = 0; t < (int)( sizeof( thread_counts ) / sizeof( thread_counts[0] ) ); ++t )
+            {
+                const int num_lists = list_counts[l];
+                const int num_nodes = num_lists * nodes_per_list[n];
+                node_pool_reset( &pool );
+                if( !create_random_lists_pooled( &pool, lists, num_lists, nodes_per_list[n], 7 + l, 0 ) ||
+                    !check_merged( merge_lists_pairwise( lists, num_lists, thread_counts[t] ), num_nodes ) )
+                {
+                    printf( "pairwise merge FAILED: %d lists of %d, %d threads\n", num_lists, nodes_per_list[n], thread_counts[t] );
+                    ok = 0;
+                }
+            }
+        }
+    }
+
+    node_pool_destroy( &pool );
+    free( lists );
+    return ok;
+}
+
+void sort_lists_benchmark( void )
+{
+    if( verify_pairwise_merge() )
+    {
+        printf( "pairwise merge check (1 to 8 threads): ok\n" );
+    }
+
+    #define BENCH_CONFIGS 4
+    static const int list_counts[BENCH_CONFIGS] = { 1000, 16000, 1000, 10000 };
+    static const int node_counts[BENCH_CONFIGS] = { 1000000, 4000000, 10000000, 10000000 };
+
+    // The original linear scan is O(N k); only run it while that's under ~10^9 steps.
+    #define LINEAR_SCAN_LIMIT 1000000000.0
+
+    const int threads = cpu_count();
+    printf( "k-way merge benchmark (%d threads for the pairwise tree)\n", threads );
+    printf( "%8s %10s %-20s %10s\n", "lists", "nodes", "method", "ms" );
+
+    for( int config = 0; config < BENCH_CONFIGS; ++config )
+    {
+        const int num_lists = list_counts[config];
+        const int num_nodes = node_counts[config];
+        LL_NODE** lists = (LL_NODE**)malloc( num_lists * sizeof(LL_NODE*) );
+        NODE_POOL pool;
+        if( !lists || !node_pool_init( &pool, num_nodes ) )
+        {
+            free( lists );
+            return;
+        }
+
+        struct
+        {
+            const char* name;
+            MERGE_FUNC  merge;
+            int         threads;
+        } methods[] =
+        {
+            { "linear scan",       merge_linear_adapter,  1 },
+            { "binary heap",       merge_heap_adapter,    1 },
+            { "pairwise, 1 thread", merge_lists_pairwise, 1 },
+            { "pairwise, parallel", merge_lists_pairwise, threads },
+        };
+
+        for( int m = 0; m < (int)( sizeof( methods ) / sizeof( methods[0] ) ); ++m )
+        {
+            if( m == 0 && (double)num_nodes * num_lists > LINEAR_SCAN_LIMIT )
+            {
+                printf( "%8d %10d %-20s %10s\n", num_lists, num_nodes, methods[m].name, "skipped" );
+                continue;
+            }
+            if( m == 3 && threads == 1 )
+            {
+                continue;   // one core: same as the line above
+            }
+
+            // Same seed every time, so every method merges the same lists.
+            node_pool_reset( &pool );
+            const double build_start = seconds_now();
+            create_random_lists_pooled( &pool, lists, num_lists, num_nodes / num_lists, 42, 0 );
+            const double build_time = seconds_now() - build_start;
+            if( m == 1 )
+            {
+                printf( "%8d %10d %-20s %10.1f\n", num_lists, num_nodes, "(build lists)", build_time * 1e3 );
+            }
+
+            const double start = seconds_now();
+            LL_NODE* merged = methods[m].merge( lists, num_lists, methods[m].threads );
+            const double elapsed = seconds_now() - start;
+
+            const int ok = check_merged( merged, num_nodes );
+            printf( "%8d %10d %-20s %10.1f%s\n", num_lists, num_nodes, methods[m].name, elapsed * 1e3, ok ? "" : "  BAD MERGE" );
+        }
+
+        node_pool_destroy( &pool );
+        free( lists );
+    }
+}
+
+// Sum of every value in the lists, one list after another: just the pointer chasing,
+// without the merge's heap work on top.
+static long long walk_lists( LL_NODE** lists, int num_lists )
+{
+    long long sum = 0;
+    for( int i = 0; i < num_lists; ++i )
+    {
+        for( const LL_NODE* node = lists[i]; node != NULL; node = node->next )
+        {
+            sum += node->value;
+        }
+    }
+    return sum;
+}
+
+static long long walk_alists( const ALIST_NODE* nodes, const int* heads, int num_lists )
+{
+    long long sum = 0;
+    for( int i = 0; i < num_lists; ++i )
+    {
+        for( int index = heads[i]; index != ALIST_END; index = nodes[index].next )
+        {
+            sum += nodes[index].value;
+        }
+    }
+    return sum;
+}
+
+static long long walk_ulists( UL_NODE** lists, int num_lists )
+{
+    long long sum = 0;
+    for( int i = 0; i < num_lists; ++i )
+    {
+        for( const UL_NODE* node = lists[i]; node != NULL; node = node->next )
+        {
+            for( int v = 0; v < node->count; ++v )
+            {
+                sum += node->values[v];
+            }
+        }
+    }
+    return sum;
+}
+
+// The heap merge on each list layout.  The big size is well past any last level
+// cache, so every node the merge visits is a cache miss unless the layout (or the
+// prefetcher) brought it in already.
+void list_layout_benchmark( void )
+{
+    #define LAYOUT_CONFIGS 2
+    static const int list_counts[LAYOUT_CONFIGS] = { 100, 1000 };
+    static const int node_counts[LAYOUT_CONFIGS] = { 100000, 20000000 };
+    static const char* layouts[] = { "pointer, in order", "pointer, scattered", "index-linked", "unrolled" };
+
+    printf( "k-way heap merge by list layout\n" );
+    printf( "%8s %10s %-20s %8s %10s %10s %10s %8s\n", "lists", "nodes", "layout", "MB", "build ms", "walk ms", "merge ms", "ns/node" );
+
+    for( int config = 0; config < LAYOUT_CONFIGS; ++config )
+    {
+        const int num_lists = list_counts[config];
+        const int num_nodes = node_counts[config];
+        const int per_list = num_nodes / num_lists;
+
+        for( int layout = 0; layout < (int)( sizeof( layouts ) / sizeof( layouts[0] ) ); ++layout )
+        {
+            double build_time = 0.0;
+            double walk_time = 0.0;
+            double merge_time = 0.0;
+            long long sum = 0;
+            double megabytes = 0.0;
+            int ok = 0;
+
+            const double build_start = seconds_now();
+            if( layout <= 1 )
+            {
+                LL_NODE** lists = (LL_NODE**)malloc( num_lists * sizeof(LL_NODE*) );
+                NODE_POOL pool;
+                if( lists && node_pool_init( &pool, num_nodes ) )
+                {
+                    create_random_lists_pooled( &pool, lists, num_lists, per_list, 42, layout == 1 );
+                    build_time = seconds_now() - build_start;
+                    megabytes = (double)num_nodes * sizeof(LL_NODE) / ( 1024 * 1024 );
+
+                    const double walk_start = seconds_now();
+                    sum = walk_lists( lists, num_lists );
+                    walk_time = seconds_now() - walk_start;
+
+                    const double start = seconds_now();
+                    LL_NODE* merged = merge_lists_heap( lists, num_lists );
+                    merge_time = seconds_now() - start;
+                    ok = check_merged( merged, num_nodes );
+                    node_pool_destroy( &pool );
+                }
+                free( lists );
+            }
+            else if( layout == 2 )
+            {
+                ALIST_NODE* nodes = (ALIST_NODE*)malloc( (size_t)num_nodes * sizeof(ALIST_NODE) );
+                int* heads = (int*)malloc( num_lists * sizeof(int) );
+                if( nodes && heads )
+                {
+                    create_random_alists( nodes, heads, num_lists, per_list, 42 );
+                    build_time = seconds_now() - build_start;
+                    megabytes = (double)num_nodes * sizeof(ALIST_NODE) / ( 1024 * 1024 );
+
+                    const double walk_start = seconds_now();
+                    sum = walk_alists( nodes, heads, num_lists );
+                    walk_time = seconds_now() - walk_start;
+
+                    const double start = seconds_now();
+                    const int merged = merge_alists_heap( nodes, heads, num_lists );
+                    merge_time = seconds_now() - start;
+                    ok = check_merged_alist( nodes, merged, num_nodes );
+                }
+                free( nodes );
+                free( heads );
+            }
+            else
+            {
+                UL_NODE** lists = (UL_NODE**)malloc( num_lists * sizeof(UL_NODE*) );
+                UL_POOL in = { NULL, num_lists * ul_nodes_for( per_list ), 0 };
+                UL_POOL out = { NULL, ul_nodes_for( num_nodes ), 0 };
+                in.nodes = (UL_NODE*)malloc( (size_t)in.capacity * sizeof(UL_NODE) );
+                out.nodes = (UL_NODE*)malloc( (size_t)out.capacity * sizeof(UL_NODE) );
+                if( lists && in.nodes && out.nodes )
+                {
+                    create_random_ulists( &in, lists, num_lists, per_list, 42 );
+                    build_time = seconds_now() - build_start;
+                    megabytes = (double)in.capacity * sizeof(UL_NODE) / ( 1024 * 1024 );
+
+                    const double walk_start = seconds_now();
+                    sum = walk_ulists( lists, num_lists );
+                    walk_time = seconds_now() - walk_start;
+
+                    const double start = seconds_now();
+                    UL_NODE* merged = merge_ulists_heap( lists, num_lists, &out );
+                    merge_time = seconds_now() - start;
+                    ok = check_merged_ulist( merged, num_nodes );
+                }
+                free( lists );
+                free( in.nodes );
+                free( out.nodes );
+            }
+
+            // Values are 1..num_nodes, so the walk has to add up to the triangle number.
+            ok = ok && ( sum == (long long)num_nodes * ( num_nodes + 1 ) / 2 );
+            printf( "%8d %10d %-20s %8.1f %10.1f %10.1f %10.1f %8.1f%s\n", num_lists, num_nodes, layouts[layout], megabytes,
+                    build_time * 1e3, walk_time * 1e3, merge_time * 1e3, merge_time * 1e9 / num_nodes, ok ? "" : "  BAD MERGE" );
+        }
+    }
+}
+
 int sort_lists( void )
 {
     #define NUM_LISTS 4
@@ -1,8 +1,19 @@
 // MostSignificantBit.cpp : This file contains the 'main' function. Program execution begins and ends there.
 // Efficient method of identifying the most significant bit of an integer type.
 // Returns -1 if no bits are set in the input value.
+//
+// MsbSet below is the original portable binary search.  bit_ops.hpp has the
+// constexpr, intrinsic and bulk array versions; main() checks they all agree
+// and then times them against the binary search.
+#include <algorithm>
+#include <chrono>
 #include <climits>
+#include <cstdint>
 #include <iostream>
+#include <random>
+#include <vector>
+
+#include "bit_ops.hpp"
 
 using ULONG = unsigned long;
 using ULONG64 = unsigned long long;
@@ -39,6 +50,140 @@ ULONG MsbSet( T Value )
     return msb;
 }
 
+// Run a pass REP_COUNT times and return the median time in nanoseconds per element.
+template<typename F>
+static double MedianNsPerElement( const size_t count, F&& pass )
+{
+    static const int REP_COUNT = 5;
+
+    std::vector<double> timings;
+    for( int rep = 0; rep < REP_COUNT; ++rep )
+    {
+        auto start = std::chrono::steady_clock::now();
+        pass();
+        auto end = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double, std::nano> elapsed = end - start;
+        timings.push_back( elapsed.count() / static_cast<double>( count ) );
+    }
+
+    std::sort( timings.begin(), timings.end() );
+    return timings[ timings.size() / 2 ];
+}
+
+// Compare every implementation against the binary search, then time them.
+static void MsbBenchmark( void )
+{
+    static const size_t VALUE_COUNT = 1 << 22;
+
+    // Random values with a random bit length so the MSB is evenly spread.
+    std::mt19937_64 gen( 3234 );
+    std::vector<uint64_t> longs( VALUE_COUNT );
+    std::vector<uint32_t> shorts( VALUE_COUNT );
+    for( size_t n = 0; n < VALUE_COUNT; ++n )
+    {
+        const uint64_t bits = gen();
+        longs[ n ]  = bits >> ( bits & 63 );
+        shorts[ n ] = static_cast<uint32_t>( bits >> 32 ) >> ( bits & 31 );
+    }
+    longs[ 0 ] = 0;
+    shorts[ 0 ] = 0;
+
+    std::vector<int32_t> expected( VALUE_COUNT );
+    std::vector<int32_t> result( VALUE_COUNT );
+    size_t mismatches = 0;
+
+    auto check = [ & ]( const char* label )
+    {
+        size_t bad = 0;
+        for( size_t n = 0; n < VALUE_COUNT; ++n )
+        {
+            bad += ( expected[ n ] != result[ n ] );
+        }
+
+        if( bad )
+        {
+            std::cout << "MISMATCH in " << label << "\n";
+        }
+        mismatches += bad;
+    };
+
+    std::cout << "\n" << VALUE_COUNT << " random values, median ns/value:\n";
+
+    // 64-bit values
+    double ns = MedianNsPerElement( VALUE_COUNT, [ & ]()
+    {
+        for( size_t n = 0; n < VALUE_COUNT; ++n ) expected[ n ] = static_cast<int32_t>( MsbSet( longs[ n ] ) );
+    } );
+    std::cout << "  64-bit binary search (MsbSet):  " << ns << "\n";
+
+    ns = MedianNsPerElement( VALUE_COUNT, [ & ]()
+    {
+        for( size_t n = 0; n < VALUE_COUNT; ++n ) result[ n ] = bit_ops::ct::msb( longs[ n ] );
+    } );
+    check( "ct::msb<uint64_t>" );
+    std::cout << "  64-bit de Bruijn (ct::msb):     " << ns << "\n";
+
+    ns = MedianNsPerElement( VALUE_COUNT, [ & ]()
+    {
+        for( size_t n = 0; n < VALUE_COUNT; ++n ) result[ n ] = bit_ops::msb( longs[ n ] );
+    } );
+    check( "msb<uint64_t>" );
+    std::cout << "  64-bit intrinsic (msb):         " << ns << "\n";
+
+    ns = MedianNsPerElement( VALUE_COUNT, [ & ]()
+    {
+        bit_ops::msb_array( longs.data(), VALUE_COUNT, result.data() );
+    } );
+    check( "msb_array<uint64_t>" );
+    std::cout << "  64-bit bulk (msb_array):        " << ns << "\n";
+
+    // 32-bit values
+    ns = MedianNsPerElement( VALUE_COUNT, [ & ]()
+    {
+        for( size_t n = 0; n < VALUE_COUNT; ++n ) expected[ n ] = static_cast<int32_t>( MsbSet( shorts[ n ] ) );
+    } );
+    std::cout << "  32-bit binary search (MsbSet):  " << ns << "\n";
+
+    ns = MedianNsPerElement( VALUE_COUNT, [ & ]()
+    {
+        for( size_t n = 0; n < VALUE_COUNT; ++n ) result[ n ] = bit_ops::msb( shorts[ n ] );
+    } );
+    check( "msb<uint32_t>" );
+    std::cout << "  32-bit intrinsic (msb):         " << ns << "\n";
+
+    ns = MedianNsPerElement( VALUE_COUNT, [ & ]()
+    {
+        bit_ops::msb_array( shorts.data(), VALUE_COUNT, result.data() );
+    } );
+    check( "msb_array<uint32_t>" );
+    std::cout << "  32-bit bulk SIMD (msb_array):   " << ns << "\n";
+
+    // LSB and popcount against their constexpr versions
+    for( size_t n = 0; n < VALUE_COUNT; ++n )
+    {
+        mismatches += ( bit_ops::lsb( longs[ n ] ) != bit_ops::ct::lsb( longs[ n ] ) );
+    }
+
+    uint64_t ct_total = 0;
+    ns = MedianNsPerElement( VALUE_COUNT, [ & ]()
+    {
+        ct_total = 0;
+        for( size_t n = 0; n < VALUE_COUNT; ++n ) ct_total += static_cast<uint64_t>( bit_ops::ct::popcount( longs[ n ] ) );
+    } );
+    std::cout << "  64-bit SWAR popcount (ct):      " << ns << "\n";
+
+    uint64_t total = 0;
+    ns = MedianNsPerElement( VALUE_COUNT, [ & ]()
+    {
+        total = bit_ops::popcount_array( longs.data(), VALUE_COUNT );
+    } );
+    mismatches += ( total != ct_total );
+    std::cout << "  64-bit bulk popcount:           " << ns << "\n";
+
+    std::cout << mismatches << " mismatches\n";
+}
+
 int main()
 {
     const ULONG64 TestLongs[] =
@@ -74,6 +219,8 @@ int main()
     {
         std::cout << "0x" << std::hex << TestShorts[ i ] << " = " << std::dec << MsbSet( TestShorts[ i ] ) << std::endl;
     }
+
+    MsbBenchmark();
 }
 
 // Run program: Ctrl + F5 or Debug > Start Without Debugging menu
@@ -0,0 +1,497 @@
+#pragma once
+// Bit operations: most significant set bit, least significant set bit and population count.
+//
+// Three flavours of the same operations:
+//   bit_ops::ct::*      constexpr, no recursion and no intrinsics, so they work in
+//                       template arguments and static_asserts.  MSB/LSB are a de Bruijn
+//                       multiply and a 64 entry table lookup, popcount is SWAR.
+//   bit_ops::*          runtime scalar versions built on the compiler intrinsics
+//                       (bsr/tzcnt on x86, clz on ARM).  Falls back to ct::* elsewhere.
+//   bit_ops::*_array    bulk versions over whole arrays.  The kernel is picked once at
+//                       runtime from what the CPU supports: AVX2 or SSE2 for 32-bit MSB,
+//                       LZCNT for 64-bit MSB and POPCNT for popcount on x86, NEON on ARM64.
+//
+// MSB/LSB return the zero based bit index, or -1 if no bits are set (same as MsbSet).
+// Works on 8, 16, 32, 64 and (where the compiler has it) 128-bit integer types.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined( __x86_64__ ) || defined( _M_X64 )
+    #if defined( _MSC_VER )
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    #define BIT_OPS_X64 1
+#elif defined( __aarch64__ ) || defined( _M_ARM64 )
+    #if defined( _MSC_VER )
+        #include <intrin.h>
+    #endif
+    #include <arm_neon.h>
+    #define BIT_OPS_ARM64 1
+#endif
+
+// MSVC lets any function use any instruction set; GCC and Clang need to be told.
+#if defined( _MSC_VER ) && !defined( __clang__ )
+    #define BIT_OPS_TARGET( isa )
+#else
+    #define BIT_OPS_TARGET( isa ) __attribute__( ( target( isa ) ) )
+#endif
+
+namespace bit_ops
+{
+
+namespace detail
+{
+    static constexpr uint64_t debruijn64 = 0x03f79d71b4cb0a89ull;
+
+    // ( ( 2^(n+1) - 1 ) * debruijn64 ) >> 58 is unique for every n, so a 64 entry
+    // table maps it straight back to n.  Both MSB (after smearing the bits right)
+    // and LSB (v ^ ( v - 1 )) produce that 2^(n+1) - 1 pattern.
+    constexpr std::array<int8_t, 64> build_debruijn_table()
+    {
+        std::array<int8_t, 64> table{};
+        uint64_t pattern = 0;
+        for( int n = 0; n < 64; ++n )
+        {
+            pattern = ( pattern << 1 ) | 1;
+            table[ ( pattern * debruijn64 ) >> 58 ] = static_cast<int8_t>( n );
+        }
+        return table;
+    }
+
+    static constexpr auto debruijn_table = build_debruijn_table();
+
+    // Every slot must be hit exactly once, otherwise the multiplier is wrong.
+    constexpr bool debruijn_table_is_complete()
+    {
+        uint64_t seen = 0;
+        for( int8_t n : debruijn_table )
+        {
+            seen |= 1ull << n;
+        }
+        return seen == UINT64_MAX && debruijn_table[ 0 ] == 0;
+    }
+    static_assert( debruijn_table_is_complete() );
+
+    // Set every bit below the most significant one, e.g. 0b0100'1000 -> 0b0111'1111
+    constexpr uint64_t smear_right( uint64_t value )
+    {
+        value |= value >> 1;
+        value |= value >> 2;
+        value |= value >> 4;
+        value |= value >> 8;
+        value |= value >> 16;
+        value |= value >> 32;
+        return value;
+    }
+
+    constexpr int msb64( const uint64_t value )
+    {
+        return value ? debruijn_table[ ( smear_right( value ) * debruijn64 ) >> 58 ] : -1;
+    }
+
+    constexpr int lsb64( const uint64_t value )
+    {
+        return value ? debruijn_table[ ( ( value ^ ( value - 1 ) ) * debruijn64 ) >> 58 ] : -1;
+    }
+
+    constexpr int popcount64( uint64_t value )
+    {
+        value = value - ( ( value >> 1 ) & 0x5555555555555555ull );
+        value = ( value & 0x3333333333333333ull ) + ( ( value >> 2 ) & 0x3333333333333333ull );
+        value = ( value + ( value >> 4 ) ) & 0x0F0F0F0F0F0F0F0Full;
+        return static_cast<int>( ( value * 0x0101010101010101ull ) >> 56 );
+    }
+
+    // Zero extend any integer of up to 64 bits; signed values keep their bit pattern.
+    template<typename T>
+    constexpr uint64_t widen( const T value )
+    {
+        static_assert( sizeof( T ) <= sizeof( uint64_t ) );
+        if constexpr( sizeof( T ) == 1 )      return static_cast<uint8_t>( value );
+        else if constexpr( sizeof( T ) == 2 ) return static_cast<uint16_t>( value );
+        else if constexpr( sizeof( T ) == 4 ) return static_cast<uint32_t>( value );
+        else                                  return static_cast<uint64_t>( value );
+    }
+
+    // 128-bit values are handled as two 64-bit halves.
+    template<typename T>
+    constexpr uint64_t high_half( const T value )
+    {
+        return static_cast<uint64_t>( value >> 64 );
+    }
+}
+
+namespace ct
+{
+    template<typename T>
+    constexpr int msb( const T value )
+    {
+        if constexpr( sizeof( T ) > sizeof( uint64_t ) )
+        {
+            const uint64_t high = detail::high_half( value );
+            return high ? 64 + detail::msb64( high ) : detail::msb64( static_cast<uint64_t>( value ) );
+        }
+        else
+        {
+            return detail::msb64( detail::widen( value ) );
+        }
+    }
+
+    template<typename T>
+    constexpr int lsb( const T value )
+    {
+        if constexpr( sizeof( T ) > sizeof( uint64_t ) )
+        {
+            const uint64_t low = static_cast<uint64_t>( value );
+            const uint64_t high = detail::high_half( value );
+            return low ? detail::lsb64( low ) : ( high ? 64 + detail::lsb64( high ) : -1 );
+        }
+        else
+        {
+            return detail::lsb64( detail::widen( value ) );
+        }
+    }
+
+    template<typename T>
+    constexpr int popcount( const T value )
+    {
+        if constexpr( sizeof( T ) > sizeof( uint64_t ) )
+        {
+            return detail::popcount64( detail::high_half( value ) ) + detail::popcount64( static_cast<uint64_t>( value ) );
+        }
+        else
+        {
+            return detail::popcount64( detail::widen( value ) );
+        }
+    }
+}
+
+namespace detail
+{
+    inline int msb64_intrinsic( const uint64_t value )
+    {
+#if defined( _MSC_VER ) && !defined( __clang__ ) && ( BIT_OPS_X64 || BIT_OPS_ARM64 )
+        unsigned long index;
+        return _BitScanReverse64( &index, value ) ? static_cast<int>( index ) : -1;
+#elif defined( __GNUC__ ) || defined( __clang__ )
+        return value ? 63 - __builtin_clzll( value ) : -1;
+#else
+        return msb64( value );
+#endif
+    }
+
+    inline int lsb64_intrinsic( const uint64_t value )
+    {
+#if defined( _MSC_VER ) && !defined( __clang__ ) && ( BIT_OPS_X64 || BIT_OPS_ARM64 )
+        unsigned long index;
+        return _BitScanForward64( &index, value ) ? static_cast<int>( index ) : -1;
+#elif defined( __GNUC__ ) || defined( __clang__ )
+        return value ? __builtin_ctzll( value ) : -1;
+#else
+        return lsb64( value );
+#endif
+    }
+
+    inline int popcount64_intrinsic( const uint64_t value )
+    {
+        // Baseline x86-64 has no POPCNT; without it the compiler would call a
+        // library routine that is slower than the inline SWAR version.
+#if defined( __POPCNT__ ) || ( defined( _MSC_VER ) && defined( __AVX__ ) && BIT_OPS_X64 )
+        return static_cast<int>( _mm_popcnt_u64( value ) );
+#elif BIT_OPS_ARM64 && ( defined( __GNUC__ ) || defined( __clang__ ) )
+        return __builtin_popcountll( value );
+#else
+        return popcount64( value );
+#endif
+    }
+}
+
+template<typename T>
+inline int msb( const T value )
+{
+    if constexpr( sizeof( T ) > sizeof( uint64_t ) )
+    {
+        const uint64_t high = detail::high_half( value );
+        return high ? 64 + detail::msb64_intrinsic( high ) : detail::msb64_intrinsic( static_cast<uint64_t>( value ) );
+    }
+    else
+    {
+        return detail::msb64_intrinsic( detail::widen( value ) );
+    }
+}
+
+template<typename T>
+inline int lsb( const T value )
+{
+    if constexpr( sizeof( T ) > sizeof( uint64_t ) )
+    {
+        const uint64_t low = static_cast<uint64_t>( value );
+        const uint64_t high = detail::high_half( value );
+        return low ? detail::lsb64_intrinsic( low ) : ( high ? 64 + detail::lsb64_intrinsic( high ) : -1 );
+    }
+    else
+    {
+        return detail::lsb64_intrinsic( detail::widen( value ) );
+    }
+}
+
+template<typename T>
+inline int popcount( const T value )
+{
+    if constexpr( sizeof( T ) > sizeof( uint64_t ) )
+    {
+        return detail::popcount64_intrinsic( detail::high_half( value ) ) + detail::popcount64_intrinsic( static_cast<uint64_t>( value ) );
+    }
+    else
+    {
+        return detail::popcount64_intrinsic( detail::widen( value ) );
+    }
+}
+
+// Bulk kernels and the CPU feature checks that choose between them.
+namespace detail
+{
+    using msb32_kernel_t    = void ( * )( const uint32_t*, size_t, int32_t* );
+    using msb64_kernel_t    = void ( * )( const uint64_t*, size_t, int32_t* );
+    using popcount_kernel_t = uint64_t ( * )( const uint64_t*, size_t );
+
+    inline void msb_array_scalar( const uint32_t* values, const size_t count, int32_t* out )
+    {
+        for( size_t n = 0; n < count; ++n )
+        {
+            out[ n ] = msb64_intrinsic( values[ n ] );
+        }
+    }
+
+    inline void msb_array_scalar( const uint64_t* values, const size_t count, int32_t* out )
+    {
+        for( size_t n = 0; n < count; ++n )
+        {
+            out[ n ] = msb64_intrinsic( values[ n ] );
+        }
+    }
+
+    inline uint64_t popcount_array_scalar( const uint64_t* values, const size_t count )
+    {
+        uint64_t total = 0;
+        for( size_t n = 0; n < count; ++n )
+        {
+            total += static_cast<uint64_t>( popcount64_intrinsic( values[ n ] ) );
+        }
+        return total;
+    }
+
+#if BIT_OPS_X64
+    inline bool cpu_has( const char* feature )
+    {
+#if defined( _MSC_VER ) && !defined( __clang__ )
+        int info[ 4 ];
+        const char f = feature[ 0 ];
+        if( f == 'p' )                                 // popcnt
+        {
+            __cpuid( info, 1 );
+            return ( info[ 2 ] & ( 1 << 23 ) ) != 0;
+        }
+        if( f == 'l' )                                 // lzcnt (ABM)
+        {
+            __cpuid( info, 0x80000001 );
+            return ( info[ 2 ] & ( 1 << 5 ) ) != 0;
+        }
+        // avx2: needs the OS to save the YMM registers as well as CPU support
+        __cpuid( info, 1 );
+        if( !( info[ 2 ] & ( 1 << 27 ) ) || ( _xgetbv( 0 ) & 0x6 ) != 0x6 )
+        {
+            return false;
+        }
+        __cpuidex( info, 7, 0 );
+        return ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+#else
+        __builtin_cpu_init();
+        if( feature[ 0 ] == 'p' ) return __builtin_cpu_supports( "popcnt" );
+        if( feature[ 0 ] == 'l' ) return __builtin_cpu_supports( "lzcnt" );
+        return __builtin_cpu_supports( "avx2" );
+#endif
+    }
+
+    // No integer count-leading-zeros in SSE/AVX2, so let the float converter do it:
+    // the exponent of float( v ) is the MSB of v.  Clearing the bit just below the
+    // MSB first stops the conversion from rounding up into the next power of two.
+    // Lanes with bit 31 set look negative to the signed converter, those are 31.
+    inline void msb_array_sse2( const uint32_t* values, const size_t count, int32_t* out )
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bias = _mm_set1_epi32( 127 );
+        const __m128i top  = _mm_set1_epi32( 31 );
+
+        size_t n = 0;
+        for( ; n + 4 <= count; n += 4 )
+        {
+            const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( values + n ) );
+            const __m128i t = _mm_andnot_si128( _mm_srli_epi32( v, 1 ), v );
+            const __m128i e = _mm_sub_epi32( _mm_srli_epi32( _mm_castps_si128( _mm_cvtepi32_ps( t ) ), 23 ), bias );
+
+            const __m128i is_top  = _mm_cmplt_epi32( v, zero );
+            const __m128i is_zero = _mm_cmpeq_epi32( v, zero );
+
+            __m128i r = _mm_or_si128( _mm_andnot_si128( is_top, e ), _mm_and_si128( is_top, top ) );
+            r = _mm_or_si128( r, is_zero ); // all ones == -1
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( out + n ), r );
+        }
+
+        msb_array_scalar( values + n, count - n, out + n );
+    }
+
+    BIT_OPS_TARGET( "avx2" )
+    inline void msb_array_avx2( const uint32_t* values, const size_t count, int32_t* out )
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i bias = _mm256_set1_epi32( 127 );
+        const __m256i top  = _mm256_set1_epi32( 31 );
+
+        size_t n = 0;
+        for( ; n + 8 <= count; n += 8 )
+        {
+            const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( values + n ) );
+            const __m256i t = _mm256_andnot_si256( _mm256_srli_epi32( v, 1 ), v );
+            const __m256i e = _mm256_sub_epi32( _mm256_srli_epi32( _mm256_castps_si256( _mm256_cvtepi32_ps( t ) ), 23 ), bias );
+
+            const __m256i is_top  = _mm256_cmpgt_epi32( zero, v );
+            const __m256i is_zero = _mm256_cmpeq_epi32( v, zero );
+
+            __m256i r = _mm256_blendv_epi8( e, top, is_top );
+            r = _mm256_or_si256( r, is_zero );
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( out + n ), r );
+        }
+
+        msb_array_scalar( values + n, count - n, out + n );
+    }
+
+    // LZCNT is defined for zero (returns 64), so 63 - lzcnt needs no zero check.
+    BIT_OPS_TARGET( "lzcnt" )
+    inline void msb_array_lzcnt( const uint64_t* values, const size_t count, int32_t* out )
+    {
+        for( size_t n = 0; n < count; ++n )
+        {
+            out[ n ] = 63 - static_cast<int32_t>( _lzcnt_u64( values[ n ] ) );
+        }
+    }
+
+    BIT_OPS_TARGET( "popcnt" )
+    inline uint64_t popcount_array_popcnt( const uint64_t* values, const size_t count )
+    {
+        // Four accumulators so the adds don't serialize behind a single register.
+        uint64_t total[ 4 ] = { 0, 0, 0, 0 };
+        size_t n = 0;
+        for( ; n + 4 <= count; n += 4 )
+        {
+            total[ 0 ] += static_cast<uint64_t>( _mm_popcnt_u64( values[ n + 0 ] ) );
+            total[ 1 ] += static_cast<uint64_t>( _mm_popcnt_u64( values[ n + 1 ] ) );
+            total[ 2 ] += static_cast<uint64_t>( _mm_popcnt_u64( values[ n + 2 ] ) );
+            total[ 3 ] += static_cast<uint64_t>( _mm_popcnt_u64( values[ n + 3 ] ) );
+        }
+        for( ; n < count; ++n )
+        {
+            total[ 0 ] += static_cast<uint64_t>( _mm_popcnt_u64( values[ n ] ) );
+        }
+        return total[ 0 ] + total[ 1 ] + total[ 2 ] + total[ 3 ];
+    }
+
+    inline msb32_kernel_t select_msb32_kernel()
+    {
+        return cpu_has( "avx2" ) ? msb_array_avx2 : msb_array_sse2;
+    }
+
+    inline msb64_kernel_t select_msb64_kernel()
+    {
+        return cpu_has( "lzcnt" ) ? msb_array_lzcnt : static_cast<msb64_kernel_t>( msb_array_scalar );
+    }
+
+    inline popcount_kernel_t select_popcount_kernel()
+    {
+        return cpu_has( "popcnt" ) ? popcount_array_popcnt : popcount_array_scalar;
+    }
+#elif BIT_OPS_ARM64
+    // NEON has a per-lane count leading zeros, and clz( 0 ) = 32 gives -1 for free.
+    inline void msb_array_neon( const uint32_t* values, const size_t count, int32_t* out )
+    {
+        const int32x4_t top = vdupq_n_s32( 31 );
+
+        size_t n = 0;
+        for( ; n + 4 <= count; n += 4 )
+        {
+            const uint32x4_t v = vld1q_u32( values + n );
+            vst1q_s32( out + n, vsubq_s32( top, vreinterpretq_s32_u32( vclzq_u32( v ) ) ) );
+        }
+
+        msb_array_scalar( values + n, count - n, out + n );
+    }
+
+    inline msb32_kernel_t select_msb32_kernel()
+    {
+        return msb_array_neon;
+    }
+
+    inline msb64_kernel_t select_msb64_kernel()
+    {
+        return msb_array_scalar;
+    }
+
+    inline popcount_kernel_t select_popcount_kernel()
+    {
+        return popcount_array_scalar;
+    }
+#else
+    inline msb32_kernel_t select_msb32_kernel()
+    {
+        return msb_array_scalar;
+    }
+
+    inline msb64_kernel_t select_msb64_kernel()
+    {
+        return msb_array_scalar;
+    }
+
+    inline popcount_kernel_t select_popcount_kernel()
+    {
+        return popcount_array_scalar;
+    }
+#endif
+}
+
+// MSB of every element: out[ n ] = msb( values[ n ] ).
+inline void msb_array( const uint32_t* values, const size_t count, int32_t* out )
+{
+    static const detail::msb32_kernel_t kernel = detail::select_msb32_kernel();
+    kernel( values, count, out );
+}
+
+inline void msb_array( const uint64_t* values, const size_t count, int32_t* out )
+{
+    static const detail::msb64_kernel_t kernel = detail::select_msb64_kernel();
+    kernel( values, count, out );
+}
+
+// Total number of set bits in the array.
+inline uint64_t popcount_array( const uint64_t* values, const size_t count )
+{
+    static const detail::popcount_kernel_t kernel = detail::select_popcount_kernel();
+    return kernel( values, count );
+}
+
+}
+
+// Compile-time sanity checks.
+static_assert( bit_ops::ct::msb( 0u ) == -1 );
+static_assert( bit_ops::ct::msb( 0x13u ) == 4 );
+static_assert( bit_ops::ct::msb( static_cast<int8_t>( -1 ) ) == 7 );
+static_assert( bit_ops::ct::msb( 0x8000000000000000ull ) == 63 );
+static_assert( bit_ops::ct::lsb( 0x0000800200803040ull ) == 6 );
+static_assert( bit_ops::ct::popcount( 0x0000800200803040ull ) == 6 );
+#if defined( __SIZEOF_INT128__ )
+static_assert( bit_ops::ct::msb( static_cast<unsigned __int128>( 1 ) << 100 ) == 100 );
+static_assert( bit_ops::ct::lsb( static_cast<unsigned __int128>( 1 ) << 100 ) == 100 );
+#endif
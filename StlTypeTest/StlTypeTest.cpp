@@ -2,12 +2,25 @@
 // Some standard template library fun with types.
 // Compile time type checking for enabled or disabled feature; note that both types must be defined
 // in order for this to even compile.
+//
+// The second half uses the same trick for real hot-path features (tracing, bounds
+// checks, statistics) via feature_registry.hpp, and checks that the disabled
+// versions really cost nothing: same object size and same speed as code that was
+// written without them.
 
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+
+#include "feature_registry.hpp"
 
 // Flag to enable/disable the feature; comment this #define to get the Feature_Disabled code behaviour
 #define ENABLE_FEATURE
 
+// Flag to build the "service" code below with every feature registry feature turned on
+//#define ENABLE_INSTRUMENTATION
+
 struct FeatureTypes
 {
     typedef unsigned int    myunsignedinttype;
@@ -42,6 +55,158 @@ using Feature = Feature_Disabled<T>;
 
 struct FeatureWithTypes : Feature<FeatureTypes> {};
 
+#if defined ENABLE_INSTRUMENTATION
+static constexpr bool instrumented = true;
+#else
+static constexpr bool instrumented = false;
+#endif
+
+using ServiceFeatures = FeatureSet<SelectFeature<instrumented, Tracing_Enabled, Tracing_Disabled>,
+                                   SelectFeature<instrumented, BoundsCheck_Enabled, BoundsCheck_Disabled>,
+                                   SelectFeature<instrumented, Statistics_Enabled, Statistics_Disabled>>;
+
+// A hot-path container written once against a feature set.
+template<typename Features>
+class SampleBuffer : private Features
+{
+public:
+    enum Statistic : unsigned
+    {
+        STAT_WRITES,
+        STAT_READS,
+    };
+
+    explicit SampleBuffer( const size_t size )
+        : m_Data( new uint32_t[ size ]() )
+        , m_Size( size )
+    {
+    }
+
+    inline void Set( const size_t index, const uint32_t value )
+    {
+        Features::Check( index, m_Size );
+        Features::Trace( "set", index );
+        Features::Count( STAT_WRITES );
+        m_Data[ index ] = value;
+    }
+
+    inline uint32_t Get( const size_t index )
+    {
+        Features::Check( index, m_Size );
+        Features::Trace( "get", index );
+        Features::Count( STAT_READS );
+        return m_Data[ index ];
+    }
+
+    size_t Size() const { return m_Size; }
+
+    using Features::Counter;
+    using Features::DumpTrace;
+
+private:
+    std::unique_ptr<uint32_t[]> m_Data;
+    size_t m_Size;
+};
+
+// The same container written by hand with no features at all: the baseline.
+class PlainBuffer
+{
+public:
+    explicit PlainBuffer( const size_t size )
+        : m_Data( new uint32_t[ size ]() )
+        , m_Size( size )
+    {
+    }
+
+    inline void Set( const size_t index, const uint32_t value ) { m_Data[ index ] = value; }
+    inline uint32_t Get( const size_t index ) { return m_Data[ index ]; }
+    size_t Size() const { return m_Size; }
+
+private:
+    std::unique_ptr<uint32_t[]> m_Data;
+    size_t m_Size;
+};
+
+// Disabled features add no bytes.
+static_assert( sizeof( SampleBuffer<ProductionFeatures> ) == sizeof( PlainBuffer ) );
+
+// Write then read back every element, a few hundred times over; returns ns per element.
+template<typename Buffer>
+static double TimeBuffer( Buffer& buffer, uint64_t& checksum )
+{
+    static const int PASSES = 200;
+
+    // Local sum and size: writing through checksum every iteration would let the
+    // compiler assume it aliases the buffer and reload everything.
+    const size_t size = buffer.Size();
+    uint64_t sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for( int pass = 0; pass < PASSES; ++pass )
+    {
+        for( size_t n = 0; n < size; ++n )
+        {
+            buffer.Set( n, static_cast<uint32_t>( n * 3 + pass ) );
+        }
+        for( size_t n = 0; n < size; ++n )
+        {
+            sum += buffer.Get( n );
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    checksum = sum;
+
+    std::chrono::duration<double, std::nano> elapsed = end - start;
+    return elapsed.count() / ( static_cast<double>( PASSES ) * static_cast<double>( buffer.Size() ) );
+}
+
+static void FeatureRegistryTest( void )
+{
+    static const size_t BUFFER_SIZE = 1 << 16;
+
+    std::cout << "\nFeature registry (instrumented build: " << ( instrumented ? "yes" : "no" ) << "):\n";
+    std::cout << "  sizeof PlainBuffer                  " << sizeof( PlainBuffer ) << "\n";
+    std::cout << "  sizeof SampleBuffer<Production>     " << sizeof( SampleBuffer<ProductionFeatures> ) << "\n";
+    std::cout << "  sizeof SampleBuffer<Instrumented>   " << sizeof( SampleBuffer<InstrumentedFeatures> ) << "\n";
+
+    uint64_t plain_sum, production_sum, instrumented_sum, service_sum;
+    PlainBuffer                        plain( BUFFER_SIZE );
+    SampleBuffer<ProductionFeatures>   production( BUFFER_SIZE );
+    SampleBuffer<InstrumentedFeatures> instrumented_buffer( BUFFER_SIZE );
+    SampleBuffer<ServiceFeatures>      service( BUFFER_SIZE );
+
+    const double plain_ns        = TimeBuffer( plain, plain_sum );
+    const double production_ns   = TimeBuffer( production, production_sum );
+    const double instrumented_ns = TimeBuffer( instrumented_buffer, instrumented_sum );
+    const double service_ns      = TimeBuffer( service, service_sum );
+
+    std::cout << "  ns/element plain                    " << plain_ns << "\n";
+    std::cout << "  ns/element production               " << production_ns << "\n";
+    std::cout << "  ns/element instrumented             " << instrumented_ns << "\n";
+    std::cout << "  ns/element service build            " << service_ns << "\n";
+
+    if( plain_sum != production_sum || plain_sum != instrumented_sum || plain_sum != service_sum )
+    {
+        std::cout << "  CHECKSUM MISMATCH\n";
+    }
+
+    // Only the instrumented build sees these.
+    using Stat = SampleBuffer<InstrumentedFeatures>;
+    std::cout << "  instrumented writes " << instrumented_buffer.Counter( Stat::STAT_WRITES )
+              << ", reads " << instrumented_buffer.Counter( Stat::STAT_READS ) << "\n";
+    try
+    {
+        instrumented_buffer.Get( BUFFER_SIZE );
+        std::cout << "  bounds check missed!\n";
+    }
+    catch( const std::out_of_range& e )
+    {
+        std::cout << "  bounds check caught: " << e.what() << "\n";
+    }
+    std::cout << "  last trace events on this thread:\n";
+    instrumented_buffer.DumpTrace( std::cout );
+}
+
 int main()
 {
     using FeatureT         = Feature<FeatureTypes>;
@@ -58,6 +223,8 @@ int main()
 
     FeatureWithTypes myFeature;
     myFeature.GetNumber();
+
+    FeatureRegistryTest();
 }
 
 // Run program: Ctrl + F5 or Debug > Start Without Debugging menu
@@ -0,0 +1,150 @@
+#pragma once
+// Compile-time feature selection for hot paths.
+//
+// Same idea as Feature_Enabled / Feature_Disabled in StlTypeTest.cpp, grown into
+// something reusable.  Each feature comes as a pair of policies with the same
+// interface; the _Disabled policy's functions are empty and it holds no data,
+// so once the optimizer inlines them there's nothing left.  FeatureSet bundles
+// one policy per feature, and hot-path code is written once against a
+// FeatureSet template parameter:
+//
+//     template<typename Features>
+//     class Thing : private Features       // private base = empty base optimization
+//     {
+//         void Work( size_t i )
+//         {
+//             Features::Check( i, m_Size );    // BoundsCheck
+//             Features::Trace( "work", i );    // Tracing
+//             Features::Count( STAT_WORK );    // Statistics
+//         }
+//     };
+//
+//     Thing<ProductionFeatures>   fast;      // all features compiled out
+//     Thing<InstrumentedFeatures> checked;   // same code, everything on
+//
+// Features available:
+//   Tracing      - records (label, value) events in a small in-memory ring per thread.
+//   BoundsCheck  - throws std::out_of_range for a bad index.
+//   Statistics   - per-object event counters.
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+// MSVC only applies the empty base optimization to the first base class
+// unless asked to do it for all of them.
+#if defined( _MSC_VER )
+    #define FEATURE_EMPTY_BASES __declspec( empty_bases )
+#else
+    #define FEATURE_EMPTY_BASES
+#endif
+
+// Tracing.  Each thread has its own ring, shared by everything it traces, so
+// threads never write to the same events and need no synchronization.
+struct Tracing_Enabled
+{
+    static const size_t TRACE_DEPTH = 16;
+
+    struct TraceEvent
+    {
+        const char* label;
+        uint64_t    value;
+    };
+
+    static inline void Trace( const char* label, const uint64_t value )
+    {
+        t_Events[ t_Next++ % TRACE_DEPTH ] = { label, value };
+    }
+
+    // Print this thread's most recent events, oldest first.
+    static void DumpTrace( std::ostream& out )
+    {
+        const size_t first = ( t_Next > TRACE_DEPTH ) ? t_Next - TRACE_DEPTH : 0;
+        for( size_t n = first; n < t_Next; ++n )
+        {
+            const TraceEvent& event = t_Events[ n % TRACE_DEPTH ];
+            out << "  [" << n << "] " << event.label << " " << event.value << "\n";
+        }
+    }
+
+private:
+    static inline thread_local std::array<TraceEvent, TRACE_DEPTH> t_Events{};
+    static inline thread_local size_t t_Next = 0;
+};
+
+struct Tracing_Disabled
+{
+    static inline void Trace( const char*, const uint64_t ) {}
+    static void DumpTrace( std::ostream& ) {}
+};
+
+// Bounds checking
+struct BoundsCheck_Enabled
+{
+    static inline void Check( const size_t index, const size_t size )
+    {
+        if( index >= size )
+        {
+            throw std::out_of_range( "index out of range" );
+        }
+    }
+};
+
+struct BoundsCheck_Disabled
+{
+    static inline void Check( const size_t, const size_t ) {}
+};
+
+// Statistics; the only feature that carries state, so it's per object.
+struct Statistics_Enabled
+{
+    static const unsigned MAX_STATISTICS = 8;
+
+    // ids are STAT_ constants, so a bad one is a bug rather than bad input; unlike
+    // BoundsCheck this only costs anything in debug builds.
+    inline void Count( const unsigned id )
+    {
+        assert( id < MAX_STATISTICS );
+        ++m_Counters[ id ];
+    }
+
+    uint64_t Counter( const unsigned id ) const
+    {
+        assert( id < MAX_STATISTICS );
+        return m_Counters[ id ];
+    }
+
+private:
+    std::array<uint64_t, MAX_STATISTICS> m_Counters{};
+};
+
+struct Statistics_Disabled
+{
+    inline void Count( const unsigned ) {}
+    uint64_t Counter( const unsigned ) const { return 0; }
+};
+
+// One policy per feature.  Defaults are all disabled.
+template<typename TracingT     = Tracing_Disabled,
+         typename BoundsCheckT = BoundsCheck_Disabled,
+         typename StatisticsT  = Statistics_Disabled>
+struct FEATURE_EMPTY_BASES FeatureSet : TracingT, BoundsCheckT, StatisticsT
+{
+    static constexpr bool tracing      = std::is_same_v<TracingT, Tracing_Enabled>;
+    static constexpr bool bounds_check = std::is_same_v<BoundsCheckT, BoundsCheck_Enabled>;
+    static constexpr bool statistics   = std::is_same_v<StatisticsT, Statistics_Enabled>;
+};
+
+// Pick the _Enabled or _Disabled policy from a compile-time flag.
+template<bool Enable, typename EnabledT, typename DisabledT>
+using SelectFeature = std::conditional_t<Enable, EnabledT, DisabledT>;
+
+using ProductionFeatures   = FeatureSet<>;
+using InstrumentedFeatures = FeatureSet<Tracing_Enabled, BoundsCheck_Enabled, Statistics_Enabled>;
+
+// The whole point: a production feature set costs nothing to carry around.
+static_assert( std::is_empty_v<ProductionFeatures> );
@@ -1,12 +1,26 @@
 // TemplateMetaProgramming.cpp : This file contains the 'main' function. Program execution begins and ends there.
 // Fun with template meta-programming
-// Two examples:
+// Examples:
 // 1)  Super easy factorial example
 // 2)  Much more interesting convert a spreadsheet column number into a column letter, e.g., 1 = A, 26 = Z, 27 = AA, etc.
 //     Note that spreadsheet columns are numbered from 1, not zero (zero-based indexing confuses the masses).
+// 3-6) Member detection, bit masks, MSB and power-of-2 round up.
+// 7)  Runtime use of the spreadsheet column codec, timed against a naive loop.
+// 8)  has_thing grown up: find every field of a struct and serialize it automatically.
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cstdint>
 #include <iostream>
 #include <climits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bit_field.hpp"
+#include "bit_ops.hpp"
+#include "column_codec.hpp"
+#include "struct_serializer.hpp"
 
 // 1) Super easy factorial
 template<int N>
@@ -22,32 +36,19 @@ struct Factorial<0>
 };
 
 // 2) Super snazzy spreadsheet column number to letter
-template <unsigned int C>
+// The conversion itself lives in column_codec.hpp as constexpr functions, so the
+// same code also runs at runtime.  Wrapping it in a template forces the compiler
+// to do the work at compile time.
+template <uint64_t C>
 struct SpreadSheetColumnNameLength
 {
-    static const unsigned int length = 1 + SpreadSheetColumnNameLength<( C - 1 ) / 26>::length;
-    static_assert( length <= ( sizeof( uint64_t ) - 1 ) );
+    static constexpr size_t length = column_codec::name_length( C );
 };
 
-template <>
-struct SpreadSheetColumnNameLength<0>
-{
-    static const unsigned int length = 0;
-};
-
-template<unsigned int C>
+template<uint64_t C>
 struct SpreadSheetColumnName
 {
-    static const unsigned int shift = SpreadSheetColumnNameLength<C>::length - 1;
-    static const unsigned int temp = ( C - 1 ) % 26;
-    static const uint64_t result = ( static_cast<uint64_t>( temp + 'A' ) << ( 8 * shift ) )
-                                   | SpreadSheetColumnName<static_cast<unsigned int>( ( C - temp - 1 ) / 26 )>::result;
-};
-
-template<>
-struct SpreadSheetColumnName<0>
-{
-    static const uint64_t result = 0;
+    static constexpr column_codec::ColumnName result = column_codec::encode( C );
 };
 
 // 3) has_thing
@@ -138,51 +139,248 @@ struct NoThingHere
 
 // 4) compile time bitmask builder
 // Sometimes it's necessary to create a range of bits for bit mask operations.
-// This template builds the constant mask value.
-template<unsigned int M>
+// This template builds the constant mask value.  The masks come from the
+// constexpr functions in bit_field.hpp, one shift each instead of one template
+// instantiation per bit, and T can be anything from uint8_t to 128 bits.
+template<unsigned int M, typename T = uint64_t>
 struct bit_mask
 {
-    static const uint64_t low_mask = ( 1ull << ( M - 1 ) ) | bit_mask< M - 1>::low_mask;
-    static const uint64_t mask = ( 1ull << M ) | bit_mask< M - 1 >::mask;
-};
-
-template<>
-struct bit_mask<0>
-{
-    static const uint64_t low_mask = 0ull;
-    static const uint64_t mask = 1ull;
+    static constexpr T low_mask = bit_field::low_mask<T>( M );
+    static constexpr T mask = bit_field::mask_through<T>( M );
 };
 
-template<unsigned int L, unsigned int H>
+template<unsigned int L, unsigned int H, typename T = uint64_t>
 struct bit_mask_range
 {
-    static const uint64_t high_mask = bit_mask< H >::mask;
-    static const uint64_t low_mask = bit_mask< L >::low_mask;
-
-    static const uint64_t mask = high_mask ^ low_mask;
+    static constexpr T mask = bit_field::mask_range<T>( L, H );
 };
 
 // 5) build a compile time most-significant-bit finder
+// Used to recurse once per bit; now a single constexpr de Bruijn lookup shared
+// with the MostSignificantBit project (bit_ops.hpp).
 template<unsigned int _Value>
 struct msb
 {
-    static const int32_t value = 1 + msb< ( _Value >> 1 ) >::value;
-};
-
-template<>
-struct msb<1>
-{
-    static const int32_t value = 0;
+    static_assert( _Value != 0, "MSB of 0 is undefined" );
+    static const int32_t value = bit_ops::ct::msb( _Value );
 };
 
 // 6) build a power-of-two round-up value at compile time
 template<unsigned int _Value>
 struct round_up_pow2
 {
-    static const  int32_t msb   = msb< ( _Value ) >::value;
-    static const uint32_t value = ( _Value & ( _Value - 1 ) ) == 0 ?  1 << msb : 1 << ( msb + 1 );
+    static_assert( _Value != 0, "POW2 round up for 0 is undefined" );
+    static const uint32_t value = bit_field::round_up_pow2( _Value );
 };
 
+// 7) runtime spreadsheet column conversion
+// The constexpr codec from 2) doubles as a runtime converter.  Compare it with
+// the usual "prepend a letter to a string" loop over a large batch of columns.
+static std::string NaiveColumnName( uint64_t column )
+{
+    std::string name;
+    while( column )
+    {
+        --column;
+        name.insert( name.begin(), static_cast<char>( 'A' + ( column % 26 ) ) );
+        column /= 26;
+    }
+    return name;
+}
+
+static uint64_t NaiveColumnNumber( const std::string& name )
+{
+    uint64_t column = 0;
+    for( char c : name )
+    {
+        column = ( column * 26 ) + static_cast<uint64_t>( c - 'A' + 1 );
+    }
+    return column;
+}
+
+// Run a pass REP_COUNT times, return the best time in nanoseconds per column.
+template<typename F>
+static double BestNsPerColumn( const size_t count, F&& pass )
+{
+    static const int REP_COUNT = 5;
+
+    double best = 0.0;
+    for( int rep = 0; rep < REP_COUNT; ++rep )
+    {
+        auto start = std::chrono::steady_clock::now();
+        pass();
+        auto end = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double, std::nano> elapsed = end - start;
+        const double ns = elapsed.count() / static_cast<double>( count );
+        best = ( rep == 0 ) ? ns : std::min( best, ns );
+    }
+    return best;
+}
+
+static void ColumnCodecBenchmark( void )
+{
+    static const size_t COLUMN_COUNT = 1 << 20;
+
+    // Mostly "real" sheet widths plus a sprinkling of huge column numbers.
+    std::mt19937_64 gen( 3234 );
+    std::uniform_int_distribution<uint64_t> small_cols( 1, 20000 );
+    std::vector<uint64_t> columns( COLUMN_COUNT );
+    for( size_t n = 0; n < COLUMN_COUNT; ++n )
+    {
+        columns[ n ] = ( n % 16 ) ? small_cols( gen ) : ( gen() | 1 );
+    }
+
+    std::vector<std::string>               naive_names( COLUMN_COUNT );
+    std::vector<column_codec::ColumnName>  names( COLUMN_COUNT );
+    std::vector<uint64_t>                  decoded( COLUMN_COUNT );
+    uint64_t naive_sum = 0;
+
+    const double naive_encode = BestNsPerColumn( COLUMN_COUNT, [ & ]()
+    {
+        for( size_t n = 0; n < COLUMN_COUNT; ++n )
+        {
+            naive_names[ n ] = NaiveColumnName( columns[ n ] );
+        }
+    } );
+
+    const double naive_decode = BestNsPerColumn( COLUMN_COUNT, [ & ]()
+    {
+        naive_sum = 0;
+        for( size_t n = 0; n < COLUMN_COUNT; ++n )
+        {
+            naive_sum += NaiveColumnNumber( naive_names[ n ] );
+        }
+    } );
+
+    const double codec_encode = BestNsPerColumn( COLUMN_COUNT, [ & ]()
+    {
+        column_codec::encode_columns( columns.data(), COLUMN_COUNT, names.data() );
+    } );
+
+    const double codec_decode = BestNsPerColumn( COLUMN_COUNT, [ & ]()
+    {
+        column_codec::decode_columns( names.data(), COLUMN_COUNT, decoded.data() );
+    } );
+
+    // A header row: consecutive columns starting at 1.
+    const double codec_range = BestNsPerColumn( COLUMN_COUNT, [ & ]()
+    {
+        column_codec::encode_column_range( 1, COLUMN_COUNT, names.data() );
+    } );
+
+    // Verify everything agrees.  Re-encode the random columns since the
+    // range pass overwrote them.
+    column_codec::encode_columns( columns.data(), COLUMN_COUNT, names.data() );
+    size_t mismatches = 0;
+    uint64_t codec_sum = 0;
+    for( size_t n = 0; n < COLUMN_COUNT; ++n )
+    {
+        mismatches += ( names[ n ].view() != naive_names[ n ] ) || ( decoded[ n ] != columns[ n ] );
+        codec_sum += decoded[ n ];
+    }
+
+    std::vector<column_codec::ColumnName> header( COLUMN_COUNT );
+    column_codec::encode_column_range( 1, COLUMN_COUNT, header.data() );
+    for( size_t n = 0; n < COLUMN_COUNT; ++n )
+    {
+        mismatches += ( header[ n ].view() != NaiveColumnName( n + 1 ) );
+    }
+
+    std::cout << "naive encode:   " << naive_encode << " ns/column\n\t";
+    std::cout << "codec encode:   " << codec_encode << " ns/column\n\t";
+    std::cout << "codec range:    " << codec_range  << " ns/column (consecutive header columns)\n\t";
+    std::cout << "naive decode:   " << naive_decode << " ns/column\n\t";
+    std::cout << "codec decode:   " << codec_decode << " ns/column\n\t";
+    std::cout << COLUMN_COUNT << " columns, " << mismatches << " mismatches"
+              << ( ( naive_sum == codec_sum ) ? "" : ", CHECKSUM MISMATCH" ) << "\n";
+}
+
+// 8) compile-time struct reflection and serialization
+// struct_serializer.hpp finds the fields of plain structs, so solver state like
+// this can be saved and loaded without writing any I/O code for it.
+struct CellState
+{
+    uint16_t candidates;    // bit per possible digit
+    uint8_t  value;
+    uint8_t  fixed;
+};
+
+struct PaddedCell
+{
+    uint8_t  value;         // 3 bytes of padding follow
+    uint32_t candidates;
+};
+
+struct SolverState
+{
+    uint32_t                    generation;
+    double                      elapsed_ms;
+    std::array<CellState, 81>   cells;
+    std::vector<uint32_t>       history;
+    std::string                 name;
+};
+
+static void SerializationTest( void )
+{
+    std::cout << "field count CellState:    " << reflect::field_count<CellState>() << "\n\t";
+    std::cout << "field count PaddedCell:   " << reflect::field_count<PaddedCell>() << "\n\t";
+    std::cout << "field count SolverState:  " << reflect::field_count<SolverState>() << "\n\t";
+    std::cout << "bulk copy CellState:      " << reflect::bulk_copyable<CellState> << "\n\t";
+    std::cout << "bulk copy PaddedCell:     " << reflect::bulk_copyable<PaddedCell>
+              << " (sizeof " << sizeof( PaddedCell ) << ", packed " << reflect::packed_size<PaddedCell>() << ")\n\t";
+
+    SolverState state{};
+    state.generation = 42;
+    state.elapsed_ms = 12.5;
+    for( size_t n = 0; n < state.cells.size(); ++n )
+    {
+        state.cells[ n ] = { static_cast<uint16_t>( 0x1FF >> ( n % 9 ) ), static_cast<uint8_t>( n % 10 ), static_cast<uint8_t>( n & 1 ) };
+    }
+    state.history = { 3, 1, 4, 1, 5, 9, 2, 6 };
+    state.name = "pointing pair";
+
+    std::vector<uint8_t> bytes;
+    reflect::serialize( state, bytes );
+
+    SolverState loaded{};
+    const uint8_t* in = bytes.data();
+    const bool ok = reflect::deserialize( loaded, in, bytes.data() + bytes.size() );
+
+    std::vector<uint8_t> again;
+    reflect::serialize( loaded, again );
+    std::cout << "SolverState: " << bytes.size() << " bytes, round trip "
+              << ( ( ok && in == bytes.data() + bytes.size() && again == bytes && loaded.name == state.name ) ? "ok" : "FAILED" ) << "\n\t";
+
+    // Truncated data must fail cleanly rather than read past the end.
+    in = bytes.data();
+    std::cout << "truncated data rejected:  " << !reflect::deserialize( loaded, in, bytes.data() + bytes.size() - 1 ) << "\n\t";
+
+    // Bulk memcpy path versus the field-by-field path.
+    static const size_t CELL_COUNT = 1 << 20;
+    std::vector<CellState>  cells( CELL_COUNT, CellState{ 0x1FF, 0, 0 } );
+    std::vector<PaddedCell> padded( CELL_COUNT, PaddedCell{ 0, 0x1FF } );
+
+    bytes.clear();
+    bytes.reserve( CELL_COUNT * sizeof( PaddedCell ) + 8 );
+    auto start = std::chrono::steady_clock::now();
+    reflect::serialize( cells, bytes );
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> bulk_ns = end - start;
+
+    again.clear();
+    again.reserve( CELL_COUNT * sizeof( PaddedCell ) + 8 );
+    start = std::chrono::steady_clock::now();
+    reflect::serialize( padded, again );
+    end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> field_ns = end - start;
+
+    std::cout << "bulk serialize:  " << bulk_ns.count() / CELL_COUNT << " ns/struct ("
+              << bytes.size() << " bytes)\n\t";
+    std::cout << "field serialize: " << field_ns.count() / CELL_COUNT << " ns/struct ("
+              << again.size() << " bytes, padding dropped)\n";
+}
+
 int main()
 {
     // Exmaple 1) Factorial meta-programming test
@@ -191,62 +389,60 @@ int main()
     std::cout << "\n====\n\n";
 
     // More meta-programming fun!  This time with spreadsheet column letters
-    // This meta-program works for columns with up to 7 letters - which is
-    // larger than a 32-bit integer, so should be okay for most use cases :-)
+    // This works for any 64-bit column number, which tops out at 14 letters.
+    // Plenty for most use cases :-)
 
     std::cout << "Spreadsheet column number to letter:\n\t";
 
     // Column "A" is the first column
-    unsigned int len = SpreadSheetColumnNameLength<1>::length;
-    uint64_t result = SpreadSheetColumnName<1>::result;
-    char* text = reinterpret_cast<char*>( &result );
-    std::cout << "         1: " << len << ", " << text << "\n\t";
+    size_t len = SpreadSheetColumnNameLength<1>::length;
+    const char* text = SpreadSheetColumnName<1>::result.c_str();
+    std::cout << "                   1: " << len << ", " << text << "\n\t";
 
     // Column "Z" is the 26th
     len = SpreadSheetColumnNameLength<26>::length;
-    result = SpreadSheetColumnName<26>::result;
-    text = reinterpret_cast<char*>( &result );
-    std::cout << "        26: " << len << ", " << text << "\n\t";
+    text = SpreadSheetColumnName<26>::result.c_str();
+    std::cout << "                  26: " << len << ", " << text << "\n\t";
 
     // Column "AB" is the 28th column
     len = SpreadSheetColumnNameLength<28>::length;
-    result = SpreadSheetColumnName<28>::result;
-    text = reinterpret_cast<char*>( &result );
-    std::cout << "        28: " << len << ", " << text << "\n\t";
+    text = SpreadSheetColumnName<28>::result.c_str();
+    std::cout << "                  28: " << len << ", " << text << "\n\t";
 
     // Column "ZZ" is pretty far over there...
     len = SpreadSheetColumnNameLength<702>::length;
-    result = SpreadSheetColumnName<702>::result;
-    text = reinterpret_cast<char*>( &result );
-    std::cout << "       702: " << len << ", " << text << "\n\t";
+    text = SpreadSheetColumnName<702>::result.c_str();
+    std::cout << "                 702: " << len << ", " << text << "\n\t";
 
     // Column "AAA" is pretty far over there, too...
     len = SpreadSheetColumnNameLength<703>::length;
-    result = SpreadSheetColumnName<703>::result;
-    text = reinterpret_cast< char * >( &result );
-    std::cout << "       703: " << len << ", " << text << "\n\t";
+    text = SpreadSheetColumnName<703>::result.c_str();
+    std::cout << "                 703: " << len << ", " << text << "\n\t";
 
     // What about "ABC"?
     len = SpreadSheetColumnNameLength<731>::length;
-    result = SpreadSheetColumnName<731>::result;
-    text = reinterpret_cast<char*>( &result );
-    std::cout << "       731: " << len << ", " << text << "\n\t";
+    text = SpreadSheetColumnName<731>::result.c_str();
+    std::cout << "                 731: " << len << ", " << text << "\n\t";
 
     // What the heck is way out here? "BBB" is the answer.
     len = SpreadSheetColumnNameLength<1406>::length;
-    result = SpreadSheetColumnName<1406>::result;
-    text = reinterpret_cast<char*>( &result );
-    std::cout << "      1406: " << len << ", " << text << "\n\t";
+    text = SpreadSheetColumnName<1406>::result.c_str();
+    std::cout << "                1406: " << len << ", " << text << "\n\t";
 
-    // What column is ULONG MAX?
-#if defined( _WIN32 )
+    // What column is ULONG MAX?  Only different from the next one where long is
+    // 32 bits (Windows).
+#if ULONG_MAX != UINT64_MAX
     len = SpreadSheetColumnNameLength<ULONG_MAX>::length;
-    result = SpreadSheetColumnName<ULONG_MAX>::result;
-    text = reinterpret_cast< char * >( &result );
-    std::cout << ULONG_MAX << ": " << len << ", " << text << "\n";
-    std::cout << "\n====\n\n";
+    text = SpreadSheetColumnName<ULONG_MAX>::result.c_str();
+    std::cout << ULONG_MAX << ": " << len << ", " << text << "\n\t";
 #endif
 
+    // And the very last column a 64-bit number can name
+    len = SpreadSheetColumnNameLength<UINT64_MAX>::length;
+    text = SpreadSheetColumnName<UINT64_MAX>::result.c_str();
+    std::cout << UINT64_MAX << ": " << len << ", " << text << "\n";
+    std::cout << "\n====\n\n";
+
     // 3) compile-time structure identification
     std::cout << "Compile-time structure ID:\n\t";
     IHaveThing a;
@@ -273,7 +469,16 @@ int main()
     std::cout << "bit range 0th -  5th               (0x3F): 0x" << std::hex << bit_mask_range< 0, 5>::mask << "\n\t";
     std::cout << "         22nd - 31st         (0xFFC00000): 0x" << std::hex << bit_mask_range<22,31>::mask << "\n\t";
     std::cout << "         30th - 47th     (0xFFFFC0000000): 0x" << std::hex << bit_mask_range<30,47>::mask << "\n\t";
-    std::cout << "         46th - 63rd (0xFFFFC00000000000): 0x" << std::hex << bit_mask_range<46,63>::mask << "\n";
+    std::cout << "         46th - 63rd (0xFFFFC00000000000): 0x" << std::hex << bit_mask_range<46,63>::mask << "\n\t";
+
+    // Any unsigned width works; uint8_t is printed as an int so it isn't treated as a char.
+    std::cout << "uint8_t  2nd -  5th               (0x3C): 0x" << std::hex << +bit_mask_range< 2, 5, uint8_t>::mask << "\n\t";
+    std::cout << "uint16_t 4th - 15th             (0xFFF0): 0x" << std::hex << bit_mask_range< 4,15, uint16_t>::mask << "\n\t";
+
+    // Fields: the exponent of 1.0f is 127, and 0xFFFF with bits 4-11 cleared is 0xF00F.
+    using FloatExponent = bit_field::field<uint32_t, 23, 8>;
+    std::cout << "exponent field of 1.0f           (0x7F): 0x" << std::hex << FloatExponent::extract( 0x3F800000u ) << "\n\t";
+    std::cout << "insert 0 into bits 4-11 of 0xFFFF (0xF00F): 0x" << std::hex << bit_field::insert<uint16_t>( 0xFFFF, 0, 4, 8 ) << "\n";
     std::cout << "\n====\n\n";
 
     // 5) find value's most significant bit at compile time
@@ -298,6 +503,16 @@ int main()
     std::cout << "0x81: 0x" << std::hex << round_up_pow2<0x81>::value << "\n\t";
     std::cout << "\n====\n\n";
 
+    // 7) the same column codec at runtime, timed against a naive loop
+    std::cout << std::dec << "Runtime spreadsheet column codec:\n\t";
+    ColumnCodecBenchmark();
+    std::cout << "\n====\n\n";
+
+    // 8) struct reflection and serialization
+    std::cout << "Struct reflection and serialization:\n\t";
+    SerializationTest();
+    std::cout << "\n====\n\n";
+
     return 0;
 }
 
@@ -0,0 +1,106 @@
+#pragma once
+// Constexpr bit-field toolkit: masks, bit ranges, field extract/insert and
+// power-of-2 round up.
+//
+// No recursion anywhere.  Every mask is a single shift of an all-ones value,
+// so asking for a 63 bit mask costs the same as a 1 bit mask and none of it
+// instantiates a template per bit.  Works on any unsigned integer type from
+// 8 bits up to 128 bits (unsigned __int128 where the compiler has it).
+//
+// Bit numbers are zero based.  Ranges are inclusive of both ends, matching
+// the bit_mask_range<L, H> template it replaces.
+
+#include <climits>
+#include <cstdint>
+
+#include "bit_ops.hpp"
+
+namespace bit_field
+{
+
+template<typename T>
+static constexpr unsigned bit_count = sizeof( T ) * CHAR_BIT;
+
+template<typename T>
+static constexpr T all_ones = static_cast<T>( ~static_cast<T>( 0 ) );
+
+// Bits 0 through high, e.g. mask_through<uint8_t>( 3 ) = 0x0F.
+template<typename T = uint64_t>
+constexpr T mask_through( const unsigned high )
+{
+    static_assert( all_ones<T> > static_cast<T>( 0 ), "bit_field needs an unsigned type" );
+    return static_cast<T>( all_ones<T> >> ( bit_count<T> - 1 - high ) );
+}
+
+// The low count bits, e.g. low_mask<uint8_t>( 3 ) = 0x07.  count may be 0 or the full width.
+template<typename T = uint64_t>
+constexpr T low_mask( const unsigned count )
+{
+    return count ? mask_through<T>( count - 1 ) : static_cast<T>( 0 );
+}
+
+// Bits low through high, e.g. mask_range<uint32_t>( 22, 31 ) = 0xFFC00000.
+template<typename T = uint64_t>
+constexpr T mask_range( const unsigned low, const unsigned high )
+{
+    return static_cast<T>( mask_through<T>( high ) ^ low_mask<T>( low ) );
+}
+
+// Read the width bit field that starts at bit low.
+template<typename T>
+constexpr T extract( const T value, const unsigned low, const unsigned width )
+{
+    return static_cast<T>( ( value >> low ) & low_mask<T>( width ) );
+}
+
+// Replace the width bit field that starts at bit low; extra bits in field are dropped.
+template<typename T>
+constexpr T insert( const T value, const T field, const unsigned low, const unsigned width )
+{
+    const T mask = static_cast<T>( low_mask<T>( width ) << low );
+    return static_cast<T>( ( value & ~mask ) | ( ( field << low ) & mask ) );
+}
+
+// Smallest power of 2 >= value; 0 and 1 both round up to 1.
+// Returns 0 if the result doesn't fit in T.
+template<typename T>
+constexpr T round_up_pow2( const T value )
+{
+    if( value <= 1 )
+    {
+        return 1;
+    }
+
+    const unsigned shift = static_cast<unsigned>( bit_ops::ct::msb( static_cast<T>( value - 1 ) ) + 1 );
+    return ( shift < bit_count<T> ) ? static_cast<T>( static_cast<T>( 1 ) << shift ) : static_cast<T>( 0 );
+}
+
+// A named field at a fixed position, e.g.
+//     using Exponent = bit_field::field<uint32_t, 23, 8>;
+//     uint32_t e = Exponent::extract( bits );
+template<typename T, unsigned Low, unsigned Width>
+struct field
+{
+    static_assert( Width > 0 && Low + Width <= bit_count<T>, "field doesn't fit in T" );
+
+    static constexpr T mask = static_cast<T>( low_mask<T>( Width ) << Low );
+
+    static constexpr T extract( const T value ) { return bit_field::extract<T>( value, Low, Width ); }
+    static constexpr T insert( const T value, const T bits ) { return bit_field::insert<T>( value, bits, Low, Width ); }
+};
+
+}
+
+// Compile-time sanity checks across the supported widths.
+static_assert( bit_field::mask_through<uint8_t>( 7 ) == 0xFF );
+static_assert( bit_field::mask_range<uint16_t>( 4, 11 ) == 0x0FF0 );
+static_assert( bit_field::mask_range<uint32_t>( 22, 31 ) == 0xFFC00000u );
+static_assert( bit_field::mask_range<uint64_t>( 46, 63 ) == 0xFFFFC00000000000ull );
+static_assert( bit_field::extract<uint32_t>( 0x3F800000u, 23, 8 ) == 127 );
+static_assert( bit_field::insert<uint16_t>( 0xFFFF, 0, 4, 8 ) == 0xF00F );
+static_assert( bit_field::round_up_pow2<uint8_t>( 0x81 ) == 0 );
+static_assert( bit_field::round_up_pow2<uint32_t>( 0x81 ) == 0x100 );
+#if defined( __SIZEOF_INT128__ )
+static_assert( bit_field::mask_range<unsigned __int128>( 64, 127 ) == ( static_cast<unsigned __int128>( UINT64_MAX ) << 64 ) );
+static_assert( bit_field::round_up_pow2<unsigned __int128>( ( static_cast<unsigned __int128>( 1 ) << 100 ) + 1 ) == ( static_cast<unsigned __int128>( 1 ) << 101 ) );
+#endif
@@ -0,0 +1,231 @@
+#pragma once
+// Spreadsheet column codec: column number <-> column letters, e.g., 1 = A, 26 = Z, 27 = AA.
+//
+// Everything is constexpr, so the same functions produce compile-time constants
+// (see SpreadSheetColumnName<C>) and serve as the runtime fast path.  The runtime
+// path is table driven and close to branch free:
+//   - name length is a count of compares against a table of first-column-per-length,
+//   - letters are written two at a time from a 676 ( 26 * 26 ) entry pair table, and
+//   - decoding maps each character through a 256 entry value table.
+//
+// Column names are bijective base-26 numbers ("A" is 1, there is no zero digit).
+// Once the length L is known the bijective value turns into a plain base-26 value
+// by subtracting the first column that has L letters, which is what makes the
+// fixed-width pair table usable.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace column_codec
+{
+
+// 26^13 < 2^64 < 26^14, so any 64-bit column number fits in 14 letters.
+static constexpr size_t max_name_length = 14;
+
+// Null terminated column name; 16 bytes so arrays of names stay nicely aligned.
+struct ColumnName
+{
+    char    text[ max_name_length + 1 ];
+    uint8_t length;
+
+    constexpr const char* c_str() const { return text; }
+    constexpr std::string_view view() const { return std::string_view( text, length ); }
+};
+static_assert( sizeof( ColumnName ) == 16 );
+
+namespace detail
+{
+    // first_column[ L ] is the first column number with L letters (A, AA, AAA, ...).
+    // Entry 0 is unused; entries run through L = max_name_length.
+    constexpr std::array<uint64_t, max_name_length + 1> build_first_columns()
+    {
+        std::array<uint64_t, max_name_length + 1> first{};
+        uint64_t count = 26; // number of names with exactly L letters
+        first[ 1 ] = 1;
+        for( size_t len = 2; len <= max_name_length; ++len )
+        {
+            first[ len ] = first[ len - 1 ] + count;
+            count *= 26;
+        }
+        return first;
+    }
+
+    // All 676 two letter combinations, "AA" through "ZZ", packed back to back.
+    constexpr std::array<char, 26 * 26 * 2> build_letter_pairs()
+    {
+        std::array<char, 26 * 26 * 2> pairs{};
+        for( size_t n = 0; n < 26 * 26; ++n )
+        {
+            pairs[ ( n * 2 ) + 0 ] = static_cast<char>( 'A' + ( n / 26 ) );
+            pairs[ ( n * 2 ) + 1 ] = static_cast<char>( 'A' + ( n % 26 ) );
+        }
+        return pairs;
+    }
+
+    // Letter values 1..26 for upper and lower case letters, 0 for everything else.
+    constexpr std::array<uint8_t, 256> build_letter_values()
+    {
+        std::array<uint8_t, 256> values{};
+        for( int n = 0; n < 26; ++n )
+        {
+            values[ 'A' + n ] = static_cast<uint8_t>( n + 1 );
+            values[ 'a' + n ] = static_cast<uint8_t>( n + 1 );
+        }
+        return values;
+    }
+
+    static constexpr auto first_column  = build_first_columns();
+    static constexpr auto letter_pairs  = build_letter_pairs();
+    static constexpr auto letter_values = build_letter_values();
+}
+
+// Number of letters in the name of column; zero for column 0, which has no name.
+constexpr size_t name_length( const uint64_t column )
+{
+    size_t length = ( column != 0 );
+    for( size_t len = 2; len <= max_name_length; ++len )
+    {
+        length += ( column >= detail::first_column[ len ] );
+    }
+    return length;
+}
+
+// Column number to letters.  Column 0 produces an empty name.
+constexpr ColumnName encode( const uint64_t column )
+{
+    ColumnName name{};
+    const size_t length = name_length( column );
+    if( !length )
+    {
+        return name;
+    }
+
+    // Plain base-26 value, written right to left two letters at a time.
+    uint64_t value = column - detail::first_column[ length ];
+    size_t pos = length;
+    while( pos >= 2 )
+    {
+        const size_t pair = static_cast<size_t>( value % ( 26 * 26 ) ) * 2;
+        value /= ( 26 * 26 );
+
+        name.text[ --pos ] = detail::letter_pairs[ pair + 1 ];
+        name.text[ --pos ] = detail::letter_pairs[ pair + 0 ];
+    }
+
+    if( pos )
+    {
+        name.text[ 0 ] = static_cast<char>( 'A' + value );
+    }
+
+    name.text[ length ] = '\0';
+    name.length = static_cast<uint8_t>( length );
+    return name;
+}
+
+// Letters to column number.  Upper and lower case are both accepted.
+// Returns 0 for an empty name, a non-letter, or a name past the 64-bit range.
+constexpr uint64_t decode( const std::string_view name )
+{
+    const size_t length = name.size();
+    if( length == 0 || length > max_name_length )
+    {
+        return 0;
+    }
+
+    // Names shorter than max_name_length can't overflow, only the last
+    // letter of a max length name needs a range check.
+    const size_t safe_length = ( length < max_name_length ) ? length : ( max_name_length - 1 );
+
+    uint64_t column = 0;
+    bool     bad    = false;
+    for( size_t pos = 0; pos < safe_length; ++pos )
+    {
+        const uint8_t value = detail::letter_values[ static_cast<uint8_t>( name[ pos ] ) ];
+        bad |= ( value == 0 );
+        column = ( column * 26 ) + value;
+    }
+
+    if( length == max_name_length )
+    {
+        const uint8_t value = detail::letter_values[ static_cast<uint8_t>( name[ length - 1 ] ) ];
+        bad |= ( value == 0 ) || ( column > ( UINT64_MAX - value ) / 26 );
+        column = ( column * 26 ) + value;
+    }
+
+    return bad ? 0 : column;
+}
+
+constexpr uint64_t decode( const ColumnName& name )
+{
+    return decode( name.view() );
+}
+
+// Bulk conversions.  No allocation, one fixed size record per column.
+inline void encode_columns( const uint64_t* columns, const size_t count, ColumnName* names )
+{
+    for( size_t n = 0; n < count; ++n )
+    {
+        names[ n ] = encode( columns[ n ] );
+    }
+}
+
+inline void decode_columns( const ColumnName* names, const size_t count, uint64_t* columns )
+{
+    for( size_t n = 0; n < count; ++n )
+    {
+        columns[ n ] = decode( names[ n ] );
+    }
+}
+
+// Header rows are consecutive columns: encode the first one and then just
+// "add one" to the letters, carrying Z -> A like an odometer.  Amortized this
+// touches barely more than one letter per column.
+inline void encode_column_range( const uint64_t first, const size_t count, ColumnName* names )
+{
+    ColumnName name = encode( first );
+    for( size_t n = 0; n < count; ++n )
+    {
+        names[ n ] = name;
+
+        const uint64_t next = first + n + 1;
+        if( next <= 1 )
+        {
+            // Wrapped around through column 0.
+            name = encode( next );
+            continue;
+        }
+
+        size_t pos = name.length;
+        while( pos && name.text[ pos - 1 ] == 'Z' )
+        {
+            name.text[ --pos ] = 'A';
+        }
+
+        if( pos )
+        {
+            ++name.text[ pos - 1 ];
+        }
+        else
+        {
+            // All Z's rolled over, the name grows by one letter (all A's).
+            name.text[ name.length ] = 'A';
+            name.text[ ++name.length ] = '\0';
+        }
+    }
+}
+
+}
+
+// Compile-time sanity checks; these also prove the codec is usable in constant expressions.
+static_assert( column_codec::encode( 1 ).view() == "A" );
+static_assert( column_codec::encode( 26 ).view() == "Z" );
+static_assert( column_codec::encode( 27 ).view() == "AA" );
+static_assert( column_codec::encode( 702 ).view() == "ZZ" );
+static_assert( column_codec::encode( 703 ).view() == "AAA" );
+static_assert( column_codec::decode( "BBB" ) == 1406 );
+static_assert( column_codec::decode( "abc" ) == 731 );
+static_assert( column_codec::decode( "A1" ) == 0 );
+static_assert( column_codec::decode( column_codec::encode( UINT64_MAX ) ) == UINT64_MAX );
+static_assert( column_codec::decode( "ZZZZZZZZZZZZZZ" ) == 0 ); // past 2^64
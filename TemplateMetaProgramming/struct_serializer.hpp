@@ -0,0 +1,361 @@
+#pragma once
+// Compile-time struct reflection and packed binary serialization.
+//
+// has_thing<T> in TemplateMetaProgramming.cpp detects one member by name.  This
+// goes further and finds every field of a plain struct (an aggregate) without
+// naming any of them:
+//   - field_count<T>() tries T{ any, any, ... } with a placeholder that converts
+//     to anything, and the largest count that compiles is the number of fields.
+//   - as_tuple( value ) binds the fields with a structured binding and returns a
+//     std::tuple of references, so code can walk them with std::apply.
+//
+// serialize() / deserialize() use that to write structs as packed binary (no
+// padding bytes, native byte order) with no hand-written I/O code:
+//   - types with their own Serialize/Deserialize members use those (detected
+//     the same way has_thing detects its member),
+//   - trivially copyable types whose fields fill the whole struct are one memcpy,
+//     as are arrays and vectors of them,
+//   - everything else goes field by field: numbers, enums, std::array,
+//     std::string, std::vector and nested plain structs.
+//
+// Limits: up to max_fields fields, no C arrays as fields (use std::array; brace
+// elision makes them look like several fields), no base classes.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace reflect
+{
+
+static constexpr size_t max_fields = 12;
+
+namespace detail
+{
+    // Converts to any field type.  Never called, only used in unevaluated contexts.
+    struct any_field
+    {
+        template<typename U>
+        operator U() const;
+    };
+
+    template<typename T, typename Indices, typename = void>
+    struct brace_constructible : std::false_type {};
+
+    template<typename T, size_t... I>
+    struct brace_constructible<T, std::index_sequence<I...>,
+                               std::void_t<decltype( T{ ( ( void ) I, any_field{} )... } )>> : std::true_type {};
+
+    template<typename T, size_t N>
+    constexpr size_t count_fields()
+    {
+        if constexpr( N == 0 || brace_constructible<T, std::make_index_sequence<N>>::value )
+        {
+            return N;
+        }
+        else
+        {
+            return count_fields<T, N - 1>();
+        }
+    }
+
+    template<typename T>                struct is_std_array : std::false_type {};
+    template<typename E, size_t N>      struct is_std_array<std::array<E, N>> : std::true_type {};
+    template<typename T>                struct is_std_vector : std::false_type {};
+    template<typename E, typename A>    struct is_std_vector<std::vector<E, A>> : std::true_type {};
+}
+
+// Number of fields in the plain struct T.
+template<typename T>
+constexpr size_t field_count()
+{
+    static_assert( std::is_aggregate_v<T>, "field_count needs a plain struct" );
+    return detail::count_fields<T, max_fields>();
+}
+
+// The fields of value as a tuple of references.
+template<typename T>
+constexpr auto as_tuple( T& value )
+{
+    constexpr size_t count = field_count<std::remove_const_t<T>>();
+    static_assert( count > 0 && count <= max_fields, "as_tuple supports 1 to max_fields fields" );
+
+    if constexpr( count == 1 )
+    {
+        auto& [ m0 ] = value;
+        return std::tie( m0 );
+    }
+    else if constexpr( count == 2 )
+    {
+        auto& [ m0, m1 ] = value;
+        return std::tie( m0, m1 );
+    }
+    else if constexpr( count == 3 )
+    {
+        auto& [ m0, m1, m2 ] = value;
+        return std::tie( m0, m1, m2 );
+    }
+    else if constexpr( count == 4 )
+    {
+        auto& [ m0, m1, m2, m3 ] = value;
+        return std::tie( m0, m1, m2, m3 );
+    }
+    else if constexpr( count == 5 )
+    {
+        auto& [ m0, m1, m2, m3, m4 ] = value;
+        return std::tie( m0, m1, m2, m3, m4 );
+    }
+    else if constexpr( count == 6 )
+    {
+        auto& [ m0, m1, m2, m3, m4, m5 ] = value;
+        return std::tie( m0, m1, m2, m3, m4, m5 );
+    }
+    else if constexpr( count == 7 )
+    {
+        auto& [ m0, m1, m2, m3, m4, m5, m6 ] = value;
+        return std::tie( m0, m1, m2, m3, m4, m5, m6 );
+    }
+    else if constexpr( count == 8 )
+    {
+        auto& [ m0, m1, m2, m3, m4, m5, m6, m7 ] = value;
+        return std::tie( m0, m1, m2, m3, m4, m5, m6, m7 );
+    }
+    else if constexpr( count == 9 )
+    {
+        auto& [ m0, m1, m2, m3, m4, m5, m6, m7, m8 ] = value;
+        return std::tie( m0, m1, m2, m3, m4, m5, m6, m7, m8 );
+    }
+    else if constexpr( count == 10 )
+    {
+        auto& [ m0, m1, m2, m3, m4, m5, m6, m7, m8, m9 ] = value;
+        return std::tie( m0, m1, m2, m3, m4, m5, m6, m7, m8, m9 );
+    }
+    else if constexpr( count == 11 )
+    {
+        auto& [ m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10 ] = value;
+        return std::tie( m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10 );
+    }
+    else if constexpr( count == 12 )
+    {
+        auto& [ m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11 ] = value;
+        return std::tie( m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11 );
+    }
+}
+
+template<typename T>
+using field_types = decltype( as_tuple( std::declval<T&>() ) );
+
+// Detect the custom serialization hooks, has_thing style.
+template<typename T, typename = void>
+struct has_serialize_hook : std::false_type {};
+
+template<typename T>
+struct has_serialize_hook<T, std::void_t<
+    decltype( std::declval<const T&>().Serialize( std::declval<std::vector<uint8_t>&>() ) ),
+    decltype( std::declval<T&>().Deserialize( std::declval<const uint8_t*&>(), std::declval<const uint8_t*>() ) )>> : std::true_type {};
+
+// Size of T once packed (no padding), or 0 if T has variable size.
+template<typename T>
+constexpr size_t packed_size();
+
+namespace detail
+{
+    template<typename Tuple, size_t... I>
+    constexpr size_t packed_field_sizes( std::index_sequence<I...> )
+    {
+        constexpr size_t sizes[] = { packed_size<std::remove_cv_t<std::remove_reference_t<std::tuple_element_t<I, Tuple>>>>()... };
+        size_t total = 0;
+        for( size_t size : sizes )
+        {
+            if( size == 0 )
+            {
+                return 0;
+            }
+            total += size;
+        }
+        return total;
+    }
+}
+
+template<typename T>
+constexpr size_t packed_size()
+{
+    if constexpr( has_serialize_hook<T>::value )
+    {
+        return 0;
+    }
+    else if constexpr( std::is_arithmetic_v<T> || std::is_enum_v<T> )
+    {
+        return sizeof( T );
+    }
+    else if constexpr( detail::is_std_array<T>::value )
+    {
+        return packed_size<typename T::value_type>() * std::tuple_size_v<T>;
+    }
+    else if constexpr( std::is_aggregate_v<T> && !std::is_array_v<T> && !detail::is_std_vector<T>::value )
+    {
+        using fields = field_types<T>;
+        return detail::packed_field_sizes<fields>( std::make_index_sequence<std::tuple_size_v<fields>>() );
+    }
+    else
+    {
+        return 0;
+    }
+}
+
+// True when T's in-memory bytes are exactly its packed form, so one memcpy does it.
+template<typename T>
+static constexpr bool bulk_copyable = std::is_trivially_copyable_v<T> && packed_size<T>() == sizeof( T );
+
+template<typename T>
+void serialize( const T& value, std::vector<uint8_t>& out );
+
+template<typename T>
+bool deserialize( T& value, const uint8_t*& in, const uint8_t* end );
+
+namespace detail
+{
+    inline void write_bytes( const void* data, const size_t size, std::vector<uint8_t>& out )
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>( data );
+        out.insert( out.end(), bytes, bytes + size );
+    }
+
+    inline bool read_bytes( void* data, const size_t size, const uint8_t*& in, const uint8_t* end )
+    {
+        if( static_cast<size_t>( end - in ) < size )
+        {
+            return false;
+        }
+        std::memcpy( data, in, size );
+        in += size;
+        return true;
+    }
+
+    // Elements of an array, vector or string: one memcpy if they allow it.
+    template<typename E>
+    void serialize_elements( const E* data, const size_t count, std::vector<uint8_t>& out )
+    {
+        if constexpr( bulk_copyable<E> )
+        {
+            write_bytes( data, count * sizeof( E ), out );
+        }
+        else
+        {
+            for( size_t n = 0; n < count; ++n )
+            {
+                serialize( data[ n ], out );
+            }
+        }
+    }
+
+    template<typename E>
+    bool deserialize_elements( E* data, const size_t count, const uint8_t*& in, const uint8_t* end )
+    {
+        if constexpr( bulk_copyable<E> )
+        {
+            return read_bytes( data, count * sizeof( E ), in, end );
+        }
+        else
+        {
+            for( size_t n = 0; n < count; ++n )
+            {
+                if( !deserialize( data[ n ], in, end ) )
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    // Containers store a 64-bit element count ahead of the elements.
+    // Every element takes at least one byte, which bounds a corrupt count.
+    inline bool read_count( size_t& count, const uint8_t*& in, const uint8_t* end )
+    {
+        uint64_t stored = 0;
+        if( !read_bytes( &stored, sizeof( stored ), in, end ) || stored > static_cast<uint64_t>( end - in ) )
+        {
+            return false;
+        }
+        count = static_cast<size_t>( stored );
+        return true;
+    }
+}
+
+// Append value to out as packed binary.
+template<typename T>
+void serialize( const T& value, std::vector<uint8_t>& out )
+{
+    if constexpr( has_serialize_hook<T>::value )
+    {
+        value.Serialize( out );
+    }
+    else if constexpr( bulk_copyable<T> )
+    {
+        detail::write_bytes( &value, sizeof( T ), out );
+    }
+    else if constexpr( detail::is_std_array<T>::value )
+    {
+        detail::serialize_elements( value.data(), value.size(), out );
+    }
+    else if constexpr( std::is_same_v<T, std::string> || detail::is_std_vector<T>::value )
+    {
+        const uint64_t count = value.size();
+        detail::write_bytes( &count, sizeof( count ), out );
+        detail::serialize_elements( value.data(), value.size(), out );
+    }
+    else if constexpr( std::is_aggregate_v<T> )
+    {
+        std::apply( [ &out ]( const auto&... fields ) { ( serialize( fields, out ), ... ); }, as_tuple( value ) );
+    }
+    else
+    {
+        static_assert( std::is_aggregate_v<T>, "serialize: unsupported type" );
+    }
+}
+
+// Read value back from [ in, end ), advancing in.  False if the data runs out.
+template<typename T>
+bool deserialize( T& value, const uint8_t*& in, const uint8_t* end )
+{
+    if constexpr( has_serialize_hook<T>::value )
+    {
+        return value.Deserialize( in, end );
+    }
+    else if constexpr( bulk_copyable<T> )
+    {
+        return detail::read_bytes( &value, sizeof( T ), in, end );
+    }
+    else if constexpr( detail::is_std_array<T>::value )
+    {
+        return detail::deserialize_elements( value.data(), value.size(), in, end );
+    }
+    else if constexpr( std::is_same_v<T, std::string> || detail::is_std_vector<T>::value )
+    {
+        size_t count = 0;
+        if( !detail::read_count( count, in, end ) )
+        {
+            return false;
+        }
+        value.resize( count );
+        return detail::deserialize_elements( value.data(), count, in, end );
+    }
+    else if constexpr( std::is_aggregate_v<T> )
+    {
+        return std::apply( [ &in, end ]( auto&... fields ) { return ( deserialize( fields, in, end ) && ... ); }, as_tuple( value ) );
+    }
+    else
+    {
+        static_assert( std::is_aggregate_v<T>, "deserialize: unsupported type" );
+        return false;
+    }
+}
+
+}
@@ -1,24 +1,53 @@
 // UniqueLockTest.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
+#include <vector>
 
-struct MustLock
+#include "lock_profiler.hpp"
+#include "lock_types.hpp"
+#include "striped_map.hpp"
+
+// With PROFILE_LOCKS defined (the PROFILE_LOCKS CMake option, or -DPROFILE_LOCKS),
+// every MustLock records acquire latency and hold time histograms plus contention
+// counts, reported after the demo; rwbench profiles its map's stripe locks too.
+#if defined( PROFILE_LOCKS )
+template<typename LockT = std::mutex>
+using MustLock = ProfiledMustLock<LockT>;
+template<typename LockT>
+using MapLock = ProfiledMutex<LockT>;
+#else
+template<typename LockT = std::mutex>
+using MustLock = BasicMustLock<LockT>;
+template<typename LockT>
+using MapLock = LockT;
+#endif
+
+// Spin until ns nanoseconds have passed.  Stands in for real work; unlike sleep_for
+// it keeps the thread on the core, which is what a short critical section does.
+void BusyWork( const uint64_t ns )
 {
-public:
-    inline auto GetLock()
+    if( ns == 0 )
     {
-        return std::unique_lock<std::mutex>( m_Mutex );
+        return;
     }
+    const auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds( ns );
+    while( std::chrono::steady_clock::now() < end )
+    {
+    }
+}
 
-private:
-    std::mutex m_Mutex;
-};
-
-void thread_proc( MustLock& lock, char threadName )
+void thread_proc( MustLock<>& lock, char threadName )
 {
     for( int i = 0; i < 5; ++i )
     {
@@ -39,9 +68,9 @@ void thread_proc( MustLock& lock, char threadName )
     }
 }
 
-int main()
+void LockDemo()
 {
-    MustLock locker;
+    MustLock<> locker;
 
     std::thread th1( thread_proc, std::ref( locker ), '1' );
     std::thread th2( thread_proc, std::ref( locker ), '2' );
@@ -50,7 +79,243 @@ int main()
     th1.join();
     th2.join();
     th3.join();
+}
+
+struct BenchSettings
+{
+    uint64_t critical_ns = 100;     // work done holding the lock
+    uint64_t think_ns = 200;        // work done between acquires
+    unsigned max_threads = 4;
+    unsigned run_ms = 200;          // per lock type and thread count
+};
+
+// Start threads worker( 0 ) .. worker( threads - 1 ) together, let them run for
+// run_ms, then set stop and wait for them.  Returns the elapsed seconds.
+template<typename WorkerT>
+double RunTimed( const unsigned threads, const unsigned run_ms, std::atomic<bool>& stop, WorkerT worker )
+{
+    std::atomic<unsigned> ready( 0 );
+    std::atomic<bool> go( false );
+
+    std::vector<std::thread> pool;
+    for( unsigned index = 0; index < threads; ++index )
+    {
+        pool.emplace_back( [ &, index ]()
+        {
+            ++ready;
+            while( !go.load( std::memory_order_acquire ) )
+            {
+                std::this_thread::yield();
+            }
+            worker( index );
+        } );
+    }
+    while( ready.load() != threads )
+    {
+        std::this_thread::yield();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    go.store( true, std::memory_order_release );
+    std::this_thread::sleep_for( std::chrono::milliseconds( run_ms ) );
+    stop.store( true );
+    for( std::thread& thread : pool )
+    {
+        thread.join();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Each thread takes the lock, does critical_ns of work, lets go, does think_ns of
+// work, and repeats until time is up.  Uses the plain MustLock so profiling doesn't
+// skew the numbers.
+//
+// Throughput is total acquisitions per second.  Fairness is Jain's index over the
+// per-thread acquisition counts: 1.0 when every thread got the same share, 1/n when
+// one thread got all of it.  min/max is the worst thread's share over the best's.
+template<typename LockT>
+void LockBenchmark( const char* name, const BenchSettings& settings )
+{
+    for( unsigned threads = 1; threads <= settings.max_threads; ++threads )
+    {
+        BasicMustLock<LockT> lock;
+        uint64_t shared_count = 0;      // only touched under the lock
+        std::vector<uint64_t> acquisitions( threads, 0 );
+        std::atomic<bool> stop( false );
+
+        const double elapsed = RunTimed( threads, settings.run_ms, stop, [ & ]( const unsigned index )
+        {
+            uint64_t count = 0;
+            while( !stop.load( std::memory_order_relaxed ) )
+            {
+                {
+                    auto haveLock = lock.GetLock();
+                    ++shared_count;
+                    BusyWork( settings.critical_ns );
+                }
+                ++count;
+                BusyWork( settings.think_ns );
+            }
+            acquisitions[ index ] = count;
+        } );
+
+        uint64_t total = 0;
+        double sum_squares = 0.0;
+        for( const uint64_t count : acquisitions )
+        {
+            total += count;
+            sum_squares += static_cast<double>( count ) * count;
+        }
+        const double jain = sum_squares ? ( static_cast<double>( total ) * total ) / ( threads * sum_squares ) : 1.0;
+        const uint64_t least = *std::min_element( acquisitions.begin(), acquisitions.end() );
+        const uint64_t most = *std::max_element( acquisitions.begin(), acquisitions.end() );
+
+        printf( "%-14s %7u %12.3f %9.3f %9.3f%s\n", name, threads, total / elapsed / 1e6, jain,
+                most ? static_cast<double>( least ) / most : 1.0,
+                ( shared_count == total ) ? "" : "  MUTUAL EXCLUSION BROKEN" );
+    }
+}
+
+void RunLockBenchmarks( const BenchSettings& settings )
+{
+    printf( "Critical section %llu ns, think time %llu ns, %u ms per run, %u hardware threads\n",
+            static_cast<unsigned long long>( settings.critical_ns ), static_cast<unsigned long long>( settings.think_ns ),
+            settings.run_ms, std::thread::hardware_concurrency() );
+    printf( "%-14s %7s %12s %9s %9s\n", "Lock", "Threads", "M acq/s", "Fairness", "min/max" );
+
+    LockBenchmark<std::mutex>( "std::mutex", settings );
+    LockBenchmark<TTASSpinLock>( "TTAS spin", settings );
+    LockBenchmark<TicketLock>( "Ticket", settings );
+    LockBenchmark<MCSLock>( "MCS", settings );
+    LockBenchmark<FutexMutex>( "Futex adaptive", settings );
+}
+
+struct MapBenchSettings
+{
+    unsigned read_pct = 95;         // lookups; the rest are inserts
+    uint32_t keys = 1 << 16;
+    unsigned max_threads = 4;
+    unsigned run_ms = 200;
+};
+
+// Read-mostly cache traffic: each thread looks up or overwrites random keys, and
+// only the map's own locking stands between them.
+template<size_t Stripes, typename LockT>
+void MapBenchmark( const char* name, const MapBenchSettings& settings )
+{
+    for( unsigned threads = 1; threads <= settings.max_threads; ++threads )
+    {
+        StripedMap<uint32_t, uint64_t, Stripes, MapLock<LockT>> cache;
+        for( uint32_t key = 0; key < settings.keys; ++key )
+        {
+            cache.Insert( key, key );
+        }
+
+        std::vector<uint64_t> operations( threads, 0 );
+        std::vector<uint64_t> misses( threads, 0 );
+        std::atomic<bool> stop( false );
+
+        const double elapsed = RunTimed( threads, settings.run_ms, stop, [ & ]( const unsigned index )
+        {
+            // xorshift64; cheap enough not to hide the locking cost
+            uint64_t random = 0x9E3779B97F4A7C15ull * ( index + 1 );
+            uint64_t count = 0;
+            uint64_t missed = 0;
+            while( !stop.load( std::memory_order_relaxed ) )
+            {
+                // A batch between checks of stop, so the atomic load doesn't dominate.
+                for( int n = 0; n < 64; ++n )
+                {
+                    random ^= random << 13;
+                    random ^= random >> 7;
+                    random ^= random << 17;
+                    const uint32_t key = static_cast<uint32_t>( random >> 32 ) % settings.keys;
+                    if( ( random & 0xFFFF ) % 100 < settings.read_pct )
+                    {
+                        uint64_t value;
+                        missed += !cache.Find( key, value );
+                    }
+                    else
+                    {
+                        cache.Insert( key, random );
+                    }
+                }
+                count += 64;
+            }
+            operations[ index ] = count;
+            misses[ index ] = missed;
+        } );
+
+        uint64_t total = 0;
+        uint64_t total_misses = 0;
+        for( unsigned index = 0; index < threads; ++index )
+        {
+            total += operations[ index ];
+            total_misses += misses[ index ];
+        }
+
+        // Every key was preloaded and nothing erases, so a miss means a broken lock.
+        printf( "%-28s %7u %12.3f%s\n", name, threads, total / elapsed / 1e6,
+                ( total_misses == 0 && cache.Size() == settings.keys ) ? "" : "  MAP CORRUPTED" );
+    }
+
+#if defined( PROFILE_LOCKS )
+    // This map's stripes, every thread count together.
+    LockProfiler::Instance().Report( std::cout );
+    LockProfiler::Instance().Reset();
+    printf( "\n" );
+#endif
+}
+
+void RunMapBenchmarks( const MapBenchSettings& settings )
+{
+    printf( "%u%% reads, %u keys, %u ms per run, %u hardware threads\n",
+            settings.read_pct, settings.keys, settings.run_ms, std::thread::hardware_concurrency() );
+    printf( "%-28s %7s %12s\n", "Map", "Threads", "M ops/s" );
+
+    MapBenchmark<1, std::mutex>( "1 x std::mutex", settings );
+    MapBenchmark<1, std::shared_mutex>( "1 x std::shared_mutex", settings );
+    MapBenchmark<1, WriterPreferringRWLock>( "1 x writer-preferring RW", settings );
+    MapBenchmark<16, std::mutex>( "16 x std::mutex", settings );
+    MapBenchmark<16, std::shared_mutex>( "16 x std::shared_mutex", settings );
+    MapBenchmark<16, WriterPreferringRWLock>( "16 x writer-preferring RW", settings );
+}
+
+// UniqueLockTest                 - the original lock demo
+// UniqueLockTest bench [critical_ns] [think_ns] [max_threads] [run_ms]
+// UniqueLockTest rwbench [read_pct] [max_threads] [run_ms]
+int main( int argc, char* argv[] )
+{
+    if( argc > 1 && strcmp( argv[ 1 ], "rwbench" ) == 0 )
+    {
+        MapBenchSettings settings;
+        settings.max_threads = std::max( settings.max_threads, std::thread::hardware_concurrency() );
+        if( argc > 2 ) settings.read_pct = static_cast<unsigned>( std::min( 100, std::max( 0, atoi( argv[ 2 ] ) ) ) );
+        if( argc > 3 ) settings.max_threads = static_cast<unsigned>( std::max( 1, atoi( argv[ 3 ] ) ) );
+        if( argc > 4 ) settings.run_ms = static_cast<unsigned>( std::max( 1, atoi( argv[ 4 ] ) ) );
+
+        RunMapBenchmarks( settings );
+        return 0;
+    }
+
+    if( argc > 1 && strcmp( argv[ 1 ], "bench" ) == 0 )
+    {
+        BenchSettings settings;
+        settings.max_threads = std::max( settings.max_threads, std::thread::hardware_concurrency() );
+        if( argc > 2 ) settings.critical_ns = strtoull( argv[ 2 ], nullptr, 10 );
+        if( argc > 3 ) settings.think_ns = strtoull( argv[ 3 ], nullptr, 10 );
+        if( argc > 4 ) settings.max_threads = static_cast<unsigned>( std::max( 1, atoi( argv[ 4 ] ) ) );
+        if( argc > 5 ) settings.run_ms = static_cast<unsigned>( std::max( 1, atoi( argv[ 5 ] ) ) );
+
+        RunLockBenchmarks( settings );
+        return 0;
+    }
 
+    LockDemo();
+#if defined( PROFILE_LOCKS )
+    LockProfiler::Instance().Report( std::cout );
+#endif
     return 0;
 }
 
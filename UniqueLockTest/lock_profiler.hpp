@@ -0,0 +1,412 @@
+#pragma once
+// Lock contention profiler.
+//
+// ProfiledMustLock is a drop-in for MustLock: same GetLock() and GetSharedLock(), but
+// the mutex underneath records, per lock:
+//   - acquisitions, how many of them were shared, and how many found the lock
+//     already taken (contended),
+//   - how long each acquire waited, as a log2 histogram in nanoseconds,
+//   - how long the lock was held, same histogram.
+// Each lock owns its statistics and registers them with LockProfiler while it lives;
+// when it's destroyed they're folded into the totals for its name.  So the profiler's
+// memory grows with the live locks and distinct names, not with every lock ever made,
+// and a lock per map entry shows up as one line with a lock count.
+// LockProfiler::Instance().Report() prints every name, hottest (most total wait)
+// first; call it while the profiled locks are idle.
+//
+// All the statistics for a lock are only written while that lock is held, so they
+// don't need atomics.  Shared holders hold it together, so they also take a small
+// mutex of the lock's own around their updates; an exclusive holder can't overlap
+// with any of them.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "lock_types.hpp"
+
+// log2 bucket n holds times in [ 2^n, 2^(n+1) ) ns; bucket 0 also holds 0 ns.
+struct LockHistogram
+{
+    static const int BUCKETS = 64;
+
+    uint64_t counts[ BUCKETS ] = {};
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+
+    void Add( const uint64_t ns )
+    {
+        int bucket = 0;
+        for( uint64_t rest = ns >> 1; rest; rest >>= 1 )
+        {
+            ++bucket;
+        }
+        ++counts[ bucket ];
+        total_ns += ns;
+        max_ns = std::max( max_ns, ns );
+    }
+
+    uint64_t Samples() const
+    {
+        uint64_t samples = 0;
+        for( const uint64_t count : counts )
+        {
+            samples += count;
+        }
+        return samples;
+    }
+
+    // Upper edge of the bucket holding the given fraction of samples, e.g. 0.99.
+    uint64_t Percentile( const double fraction ) const
+    {
+        const uint64_t target = static_cast<uint64_t>( fraction * Samples() );
+        uint64_t seen = 0;
+        for( int bucket = 0; bucket < BUCKETS; ++bucket )
+        {
+            seen += counts[ bucket ];
+            if( seen > target )
+            {
+                return std::min( BucketTop( bucket ), max_ns );
+            }
+        }
+        return max_ns;
+    }
+
+    static uint64_t BucketTop( const int bucket )
+    {
+        return ( bucket >= 63 ) ? UINT64_MAX : ( ( 2ull << bucket ) - 1 );
+    }
+
+    void Merge( const LockHistogram& other )
+    {
+        for( int bucket = 0; bucket < BUCKETS; ++bucket )
+        {
+            counts[ bucket ] += other.counts[ bucket ];
+        }
+        total_ns += other.total_ns;
+        max_ns = std::max( max_ns, other.max_ns );
+    }
+};
+
+struct LockStats
+{
+    std::string   name;
+    uint64_t      locks = 1;        // how many locks these are the totals of
+    uint64_t      acquisitions = 0;
+    uint64_t      shared = 0;           // of the acquisitions
+    uint64_t      contended = 0;
+    LockHistogram wait;
+    LockHistogram hold;
+
+    void Merge( const LockStats& other )
+    {
+        locks += other.locks;
+        acquisitions += other.acquisitions;
+        shared += other.shared;
+        contended += other.contended;
+        wait.Merge( other.wait );
+        hold.Merge( other.hold );
+    }
+};
+
+class LockProfiler
+{
+public:
+    static LockProfiler& Instance()
+    {
+        static LockProfiler profiler;
+        return profiler;
+    }
+
+    // A live lock's statistics, read by reports until the lock retires them.
+    void Register( const LockStats* stats )
+    {
+        std::lock_guard<std::mutex> guard( m_Mutex );
+        m_Live.insert( stats );
+    }
+
+    // The lock is going away: keep its numbers in its name's totals.
+    void Retire( const LockStats* stats )
+    {
+        std::lock_guard<std::mutex> guard( m_Mutex );
+        m_Live.erase( stats );
+        Fold( m_Retired, *stats );
+    }
+
+    // Forget the totals of locks already destroyed, e.g. between benchmark runs.
+    void Reset()
+    {
+        std::lock_guard<std::mutex> guard( m_Mutex );
+        m_Retired.clear();
+    }
+
+    void Report( std::ostream& out )
+    {
+        std::lock_guard<std::mutex> guard( m_Mutex );
+
+        std::map<std::string, LockStats> totals = m_Retired;
+        for( const LockStats* stats : m_Live )
+        {
+            Fold( totals, *stats );
+        }
+
+        std::vector<const LockStats*> locks;
+        for( const auto& entry : totals )
+        {
+            locks.push_back( &entry.second );
+        }
+        std::sort( locks.begin(), locks.end(),
+                   []( const LockStats* a, const LockStats* b ) { return a->wait.total_ns > b->wait.total_ns; } );
+
+        out << "\nLock contention report (" << locks.size() << " lock names, most waited on first)\n";
+        for( const LockStats* stats : locks )
+        {
+            const double contended_pct = stats->acquisitions ? ( 100.0 * stats->contended / stats->acquisitions ) : 0.0;
+            out << "\n" << stats->name << " (" << stats->locks << ( stats->locks == 1 ? " lock" : " locks" ) << "): "
+                << stats->acquisitions << " acquisitions (" << stats->shared << " shared), "
+                << stats->contended << " contended (" << FormatPercent( contended_pct ) << ")\n";
+            if( !stats->acquisitions )
+            {
+                continue;
+            }
+
+            out << "          total      mean       p50       p99       max\n";
+            PrintSummary( out, "  wait", stats->wait );
+            PrintSummary( out, "  hold", stats->hold );
+
+            out << "  histogram        wait      hold\n";
+            for( int bucket = 0; bucket < LockHistogram::BUCKETS; ++bucket )
+            {
+                if( stats->wait.counts[ bucket ] || stats->hold.counts[ bucket ] )
+                {
+                    char line[ 64 ];
+                    snprintf( line, sizeof( line ), "  <= %-8s %9llu %9llu\n", FormatNs( LockHistogram::BucketTop( bucket ) ).c_str(),
+                              static_cast<unsigned long long>( stats->wait.counts[ bucket ] ),
+                              static_cast<unsigned long long>( stats->hold.counts[ bucket ] ) );
+                    out << line;
+                }
+            }
+        }
+        out << std::flush;
+    }
+
+private:
+    LockProfiler() = default;
+
+    static void Fold( std::map<std::string, LockStats>& totals, const LockStats& stats )
+    {
+        const auto found = totals.find( stats.name );
+        if( found == totals.end() )
+        {
+            totals.emplace( stats.name, stats );
+        }
+        else
+        {
+            found->second.Merge( stats );
+        }
+    }
+
+    static std::string FormatNs( const uint64_t ns )
+    {
+        char text[ 32 ];
+        if( ns == UINT64_MAX )          snprintf( text, sizeof( text ), "max" );
+        else if( ns < 10000 )           snprintf( text, sizeof( text ), "%lluns", static_cast<unsigned long long>( ns ) );
+        else if( ns < 10000000 )        snprintf( text, sizeof( text ), "%.1fus", ns / 1e3 );
+        else if( ns < 10000000000ull )  snprintf( text, sizeof( text ), "%.1fms", ns / 1e6 );
+        else                            snprintf( text, sizeof( text ), "%.1fs", ns / 1e9 );
+        return text;
+    }
+
+    static std::string FormatPercent( const double pct )
+    {
+        char text[ 16 ];
+        snprintf( text, sizeof( text ), "%.1f%%", pct );
+        return text;
+    }
+
+    static void PrintSummary( std::ostream& out, const char* label, const LockHistogram& histogram )
+    {
+        const uint64_t samples = histogram.Samples();
+        char line[ 96 ];
+        snprintf( line, sizeof( line ), "%s %10s %9s %9s %9s %9s\n", label,
+                  FormatNs( histogram.total_ns ).c_str(),
+                  FormatNs( samples ? histogram.total_ns / samples : 0 ).c_str(),
+                  FormatNs( histogram.Percentile( 0.50 ) ).c_str(),
+                  FormatNs( histogram.Percentile( 0.99 ) ).c_str(),
+                  FormatNs( histogram.max_ns ).c_str() );
+        out << line;
+    }
+
+    std::mutex                           m_Mutex;
+    std::unordered_set<const LockStats*> m_Live;
+    std::map<std::string, LockStats>     m_Retired;   // by name
+};
+
+// A lock (std::mutex by default) that records its own contention.  Meets the
+// Lockable requirements, so std::unique_lock and std::lock_guard work with it as usual,
+// and SharedLockable as well when LockT does, for std::shared_lock.
+template<typename LockT = std::mutex>
+class ProfiledMutex
+{
+public:
+    explicit ProfiledMutex( const char* name = "mutex" )
+    {
+        m_Stats.name = name;
+        LockProfiler::Instance().Register( &m_Stats );
+    }
+
+    ~ProfiledMutex()
+    {
+        LockProfiler::Instance().Retire( &m_Stats );
+    }
+
+    ProfiledMutex( const ProfiledMutex& ) = delete;
+    ProfiledMutex& operator=( const ProfiledMutex& ) = delete;
+
+    void lock()
+    {
+        const auto start = std::chrono::steady_clock::now();
+        bool contended = false;
+        if( !m_Mutex.try_lock() )
+        {
+            contended = true;
+            m_Mutex.lock();
+        }
+        m_Acquired = std::chrono::steady_clock::now();
+
+        // We own the lock now, so the statistics are ours to update.
+        ++m_Stats.acquisitions;
+        m_Stats.contended += contended;
+        m_Stats.wait.Add( ElapsedNs( start, m_Acquired ) );
+    }
+
+    bool try_lock()
+    {
+        if( !m_Mutex.try_lock() )
+        {
+            return false;
+        }
+        m_Acquired = std::chrono::steady_clock::now();
+        ++m_Stats.acquisitions;
+        m_Stats.wait.Add( 0 );
+        return true;
+    }
+
+    void unlock()
+    {
+        m_Stats.hold.Add( ElapsedNs( m_Acquired, std::chrono::steady_clock::now() ) );
+        m_Mutex.unlock();
+    }
+
+    template<typename L = LockT, std::enable_if_t<is_shared_lockable<L>::value, int> = 0>
+    void lock_shared()
+    {
+        const auto start = std::chrono::steady_clock::now();
+        bool contended = false;
+        if( !m_Mutex.try_lock_shared() )
+        {
+            contended = true;
+            m_Mutex.lock_shared();
+        }
+        const auto acquired = std::chrono::steady_clock::now();
+        SharedAcquired( acquired, ElapsedNs( start, acquired ), contended );
+    }
+
+    template<typename L = LockT, std::enable_if_t<is_shared_lockable<L>::value, int> = 0>
+    bool try_lock_shared()
+    {
+        if( !m_Mutex.try_lock_shared() )
+        {
+            return false;
+        }
+        SharedAcquired( std::chrono::steady_clock::now(), 0, false );
+        return true;
+    }
+
+    template<typename L = LockT, std::enable_if_t<is_shared_lockable<L>::value, int> = 0>
+    void unlock_shared()
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        // This thread's most recent hold of this lock.
+        uint64_t held_ns = 0;
+        for( size_t index = t_SharedHolds.size(); index-- > 0; )
+        {
+            if( t_SharedHolds[ index ].lock == this )
+            {
+                held_ns = ElapsedNs( t_SharedHolds[ index ].acquired, now );
+                t_SharedHolds.erase( t_SharedHolds.begin() + index );
+                break;
+            }
+        }
+
+        {
+            // Still held, so no writer can be updating the statistics.
+            std::lock_guard<std::mutex> guard( m_SharedStatsMutex );
+            m_Stats.hold.Add( held_ns );
+        }
+        m_Mutex.unlock_shared();
+    }
+
+private:
+    // Readers hold the lock at the same time, so each keeps its acquire time itself.
+    struct SharedHold
+    {
+        const ProfiledMutex*                  lock;
+        std::chrono::steady_clock::time_point acquired;
+    };
+
+    void SharedAcquired( const std::chrono::steady_clock::time_point acquired, const uint64_t wait_ns, const bool contended )
+    {
+        t_SharedHolds.push_back( { this, acquired } );
+
+        std::lock_guard<std::mutex> guard( m_SharedStatsMutex );
+        ++m_Stats.acquisitions;
+        ++m_Stats.shared;
+        m_Stats.contended += contended;
+        m_Stats.wait.Add( wait_ns );
+    }
+
+    static uint64_t ElapsedNs( const std::chrono::steady_clock::time_point from, const std::chrono::steady_clock::time_point to )
+    {
+        return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( to - from ).count() );
+    }
+
+    LockT                                 m_Mutex;
+    LockStats                             m_Stats;
+    std::chrono::steady_clock::time_point m_Acquired;   // exclusive holder's
+    std::mutex                            m_SharedStatsMutex;
+
+    static inline thread_local std::vector<SharedHold> t_SharedHolds;
+};
+
+// MustLock with profiling.
+template<typename LockT = std::mutex>
+struct ProfiledMustLock
+{
+public:
+    explicit ProfiledMustLock( const char* name = "MustLock" )
+        : m_Mutex( name )
+    {
+    }
+
+    inline auto GetLock()
+    {
+        return std::unique_lock<ProfiledMutex<LockT>>( m_Mutex );
+    }
+
+    inline auto GetSharedLock()
+    {
+        return ReadLock<ProfiledMutex<LockT>>( m_Mutex );
+    }
+
+private:
+    ProfiledMutex<LockT> m_Mutex;
+};
@@ -0,0 +1,423 @@
+#pragma once
+// Lock implementations for MustLock<LockT>.
+//
+// Each one is Lockable (lock / try_lock / unlock), so std::unique_lock works on them:
+//   std::mutex       - the OS mutex, the baseline.
+//   TTASSpinLock     - test and test-and-set: spin reading the flag, only try the
+//                      atomic exchange when it looks free.  Cheap, not fair.
+//   TicketLock       - take a number, wait to be served.  FIFO fair, but everyone
+//                      spins on the same cache line.
+//   MCSLock          - queue lock: each waiter spins on its own node, and the holder
+//                      hands the lock straight to the next in line.  FIFO fair, and
+//                      a release only touches one waiter's cache line.
+//   FutexMutex       - spins briefly, then sleeps in the kernel (futex on Linux,
+//                      WaitOnAddress on Windows).  Uncontended lock / unlock is one
+//                      atomic each, like the spin locks.
+//
+// Reader-writer locks are also SharedLockable (lock_shared / try_lock_shared /
+// unlock_shared) and work with std::shared_lock:
+//   std::shared_mutex          - the OS reader-writer lock.
+//   WriterPreferringRWLock     - one atomic word; once a writer is waiting, new
+//                                readers hold off so writers can't be starved.
+//
+// The spinning locks fall back to yielding the thread after a while.  With more
+// threads than cores a pure spin can burn whole time slices waiting on a holder that
+// isn't even running.
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+
+#if defined( __x86_64__ ) || defined( _M_X64 ) || defined( __i386__ ) || defined( _M_IX86 )
+    #include <immintrin.h>
+    #define LOCK_CPU_RELAX() _mm_pause()
+#elif defined( __aarch64__ ) || defined( __arm__ )
+    #define LOCK_CPU_RELAX() __asm__ __volatile__( "yield" )
+#else
+    #define LOCK_CPU_RELAX() ( (void)0 )
+#endif
+
+#if defined( __linux__ )
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#elif defined( _WIN32 )
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #pragma comment( lib, "Synchronization.lib" )
+#endif
+
+// Spin politely for a while, then start giving the core away.
+class SpinWait
+{
+public:
+    static const unsigned SPINS_BEFORE_YIELD = 64;
+
+    void Pause()
+    {
+        if( m_Spins < SPINS_BEFORE_YIELD )
+        {
+            ++m_Spins;
+            LOCK_CPU_RELAX();
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    unsigned m_Spins = 0;
+};
+
+class TTASSpinLock
+{
+public:
+    void lock()
+    {
+        SpinWait wait;
+        while( m_Locked.exchange( true, std::memory_order_acquire ) )
+        {
+            while( m_Locked.load( std::memory_order_relaxed ) )
+            {
+                wait.Pause();
+            }
+        }
+    }
+
+    bool try_lock()
+    {
+        return !m_Locked.load( std::memory_order_relaxed ) && !m_Locked.exchange( true, std::memory_order_acquire );
+    }
+
+    void unlock()
+    {
+        m_Locked.store( false, std::memory_order_release );
+    }
+
+private:
+    std::atomic<bool> m_Locked{ false };
+};
+
+class TicketLock
+{
+public:
+    void lock()
+    {
+        const uint32_t ticket = m_Next.fetch_add( 1, std::memory_order_relaxed );
+        SpinWait wait;
+        while( m_Serving.load( std::memory_order_acquire ) != ticket )
+        {
+            wait.Pause();
+        }
+    }
+
+    bool try_lock()
+    {
+        // Only take a ticket if it would be served right away.
+        uint32_t serving = m_Serving.load( std::memory_order_relaxed );
+        return m_Next.compare_exchange_strong( serving, serving + 1, std::memory_order_acquire, std::memory_order_relaxed );
+    }
+
+    void unlock()
+    {
+        m_Serving.store( m_Serving.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+    }
+
+private:
+    // Separate cache lines: takers hit m_Next, waiters watch m_Serving.
+    alignas( 64 ) std::atomic<uint32_t> m_Next{ 0 };
+    alignas( 64 ) std::atomic<uint32_t> m_Serving{ 0 };
+};
+
+// One waiter's place in an MCS queue, on its own cache line.
+struct alignas( 64 ) MCSNode
+{
+    std::atomic<MCSNode*> next{ nullptr };
+    std::atomic<bool>     locked{ false };
+    int                   slot = -1;        // in its thread's MCSLock::t_Nodes, or -1 if allocated
+};
+
+// Queue nodes come from a few kept per thread, so holding a lock or two never
+// allocates; a thread holding more MCS locks than THREAD_NODES at once gets the rest
+// from the heap.  Each unlock frees the node its lock used, so locks can be released
+// in any order.
+class MCSLock
+{
+public:
+    static const int THREAD_NODES = 8;
+
+    using Node = MCSNode;
+
+    void lock()
+    {
+        Node* node = TakeNode();
+        node->next.store( nullptr, std::memory_order_relaxed );
+        node->locked.store( true, std::memory_order_relaxed );
+
+        Node* previous = m_Tail.exchange( node, std::memory_order_acq_rel );
+        if( previous )
+        {
+            // Get in line, then spin on our own node until the holder hands over.
+            previous->next.store( node, std::memory_order_release );
+            SpinWait wait;
+            while( node->locked.load( std::memory_order_acquire ) )
+            {
+                wait.Pause();
+            }
+        }
+        m_Holder = node;
+    }
+
+    bool try_lock()
+    {
+        Node* node = TakeNode();
+        node->next.store( nullptr, std::memory_order_relaxed );
+
+        // acq_rel like lock's exchange: the next locker writes to our node.
+        Node* expected = nullptr;
+        if( !m_Tail.compare_exchange_strong( expected, node, std::memory_order_acq_rel, std::memory_order_relaxed ) )
+        {
+            FreeNode( node );
+            return false;
+        }
+        m_Holder = node;
+        return true;
+    }
+
+    void unlock()
+    {
+        Node* node = m_Holder;
+        Node* next = node->next.load( std::memory_order_acquire );
+        if( !next )
+        {
+            // Nobody queued: try to mark the lock free.
+            Node* expected = node;
+            if( m_Tail.compare_exchange_strong( expected, nullptr, std::memory_order_release, std::memory_order_relaxed ) )
+            {
+                FreeNode( node );
+                return;
+            }
+
+            // Someone swapped in behind us but hasn't linked up yet.
+            SpinWait wait;
+            while( !( next = node->next.load( std::memory_order_acquire ) ) )
+            {
+                wait.Pause();
+            }
+        }
+        next->locked.store( false, std::memory_order_release );
+
+        // Handed over; nobody else looks at our node now.
+        FreeNode( node );
+    }
+
+private:
+    static Node* TakeNode()
+    {
+        for( int slot = 0; slot < THREAD_NODES; ++slot )
+        {
+            if( !( t_Used & ( 1u << slot ) ) )
+            {
+                t_Used |= 1u << slot;
+                t_Nodes[ slot ].slot = slot;
+                return &t_Nodes[ slot ];
+            }
+        }
+        return new Node;
+    }
+
+    static void FreeNode( Node* node )
+    {
+        if( node->slot < 0 )
+        {
+            delete node;
+            return;
+        }
+        t_Used &= ~( 1u << node->slot );
+    }
+
+    static inline thread_local Node     t_Nodes[ THREAD_NODES ];
+    static inline thread_local unsigned t_Used = 0;     // bit per t_Nodes entry in use
+
+    std::atomic<Node*> m_Tail{ nullptr };
+    Node*              m_Holder = nullptr;  // only touched by the holder
+};
+
+// Three state mutex from Drepper's "Futexes Are Tricky": 0 free, 1 locked,
+// 2 locked and someone may be asleep.  unlock() only makes a system call in state 2.
+class FutexMutex
+{
+public:
+    static const unsigned SPINS_BEFORE_SLEEP = 100;
+
+    void lock()
+    {
+        uint32_t state = 0;
+        if( m_State.compare_exchange_strong( state, 1, std::memory_order_acquire, std::memory_order_relaxed ) )
+        {
+            return;
+        }
+
+        // Adaptive part: the holder is probably about to let go, so spin a little.
+        for( unsigned spin = 0; spin < SPINS_BEFORE_SLEEP; ++spin )
+        {
+            LOCK_CPU_RELAX();
+            state = 0;
+            if( m_State.load( std::memory_order_relaxed ) == 0 &&
+                m_State.compare_exchange_strong( state, 1, std::memory_order_acquire, std::memory_order_relaxed ) )
+            {
+                return;
+            }
+        }
+
+        // Sleep.  Anyone who gets the lock from here on leaves it in state 2, since
+        // there's no telling whether other sleepers remain.
+        while( m_State.exchange( 2, std::memory_order_acquire ) != 0 )
+        {
+            Wait( 2 );
+        }
+    }
+
+    bool try_lock()
+    {
+        uint32_t state = 0;
+        return m_State.compare_exchange_strong( state, 1, std::memory_order_acquire, std::memory_order_relaxed );
+    }
+
+    void unlock()
+    {
+        if( m_State.exchange( 0, std::memory_order_release ) == 2 )
+        {
+            WakeOne();
+        }
+    }
+
+private:
+    static_assert( sizeof( std::atomic<uint32_t> ) == sizeof( uint32_t ), "futex needs a plain 32 bit word" );
+
+    // Sleep as long as the state is still value.
+    void Wait( uint32_t value )
+    {
+#if defined( __linux__ )
+        syscall( SYS_futex, reinterpret_cast<uint32_t*>( &m_State ), FUTEX_WAIT_PRIVATE, value, nullptr, nullptr, 0 );
+#elif defined( _WIN32 )
+        WaitOnAddress( &m_State, &value, sizeof( value ), INFINITE );
+#else
+        if( m_State.load( std::memory_order_relaxed ) == value )
+        {
+            std::this_thread::yield();
+        }
+#endif
+    }
+
+    void WakeOne()
+    {
+#if defined( __linux__ )
+        syscall( SYS_futex, reinterpret_cast<uint32_t*>( &m_State ), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0 );
+#elif defined( _WIN32 )
+        WakeByAddressSingle( &m_State );
+#endif
+    }
+
+    std::atomic<uint32_t> m_State{ 0 };
+};
+
+// Reader count in the low bits, then the writer flag, then the count of writers
+// waiting.  Readers only get in when there's no writer and none waiting.
+class WriterPreferringRWLock
+{
+public:
+    void lock_shared()
+    {
+        SpinWait wait;
+        while( !try_lock_shared() )
+        {
+            wait.Pause();
+        }
+    }
+
+    bool try_lock_shared()
+    {
+        uint32_t state = m_State.load( std::memory_order_relaxed );
+        return !( state & ( WRITER | WAITING_MASK ) ) &&
+               m_State.compare_exchange_weak( state, state + READER, std::memory_order_acquire, std::memory_order_relaxed );
+    }
+
+    void unlock_shared()
+    {
+        m_State.fetch_sub( READER, std::memory_order_release );
+    }
+
+    void lock()
+    {
+        // Announce ourselves first; that shuts out new readers.
+        m_State.fetch_add( WAITING_WRITER, std::memory_order_relaxed );
+        SpinWait wait;
+        for( ;; )
+        {
+            uint32_t state = m_State.load( std::memory_order_relaxed );
+            if( !( state & ( WRITER | READER_MASK ) ) &&
+                m_State.compare_exchange_weak( state, state - WAITING_WRITER + WRITER, std::memory_order_acquire, std::memory_order_relaxed ) )
+            {
+                return;
+            }
+            wait.Pause();
+        }
+    }
+
+    bool try_lock()
+    {
+        uint32_t state = m_State.load( std::memory_order_relaxed );
+        return !( state & ( WRITER | READER_MASK ) ) &&
+               m_State.compare_exchange_strong( state, state + WRITER, std::memory_order_acquire, std::memory_order_relaxed );
+    }
+
+    void unlock()
+    {
+        m_State.fetch_sub( WRITER, std::memory_order_release );
+    }
+
+private:
+    static const uint32_t READER         = 1;
+    static const uint32_t READER_MASK    = 0xFFFF;
+    static const uint32_t WRITER         = 1u << 16;
+    static const uint32_t WAITING_WRITER = 1u << 17;
+    static const uint32_t WAITING_MASK   = ~( READER_MASK | WRITER );
+
+    std::atomic<uint32_t> m_State{ 0 };
+};
+
+// The lock to take for reading: shared if the lock type has a shared mode,
+// exclusive otherwise.
+template<typename LockT, typename = void>
+struct is_shared_lockable : std::false_type {};
+
+template<typename LockT>
+struct is_shared_lockable<LockT, std::void_t<decltype( std::declval<LockT&>().lock_shared() )>> : std::true_type {};
+
+template<typename LockT>
+using ReadLock = std::conditional_t<is_shared_lockable<LockT>::value, std::shared_lock<LockT>, std::unique_lock<LockT>>;
+
+// MustLock over any of the above (or anything else Lockable).
+template<typename LockT = std::mutex>
+struct BasicMustLock
+{
+public:
+    inline auto GetLock()
+    {
+        return std::unique_lock<LockT>( m_Mutex );
+    }
+
+    // Shared with other readers when LockT allows it, exclusive when it doesn't.
+    inline auto GetSharedLock()
+    {
+        return ReadLock<LockT>( m_Mutex );
+    }
+
+private:
+    LockT m_Mutex;
+};
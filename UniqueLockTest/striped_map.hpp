@@ -0,0 +1,86 @@
+#pragma once
+// Hash map split into independently locked stripes.
+//
+// A cache behind one mutex serializes every lookup, even though lookups don't
+// conflict with each other.  Two fixes, which combine:
+//   - a reader-writer lock, so lookups run side by side and only updates are exclusive,
+//   - striping: the key's hash picks one of Stripes sub-maps, each with its own lock,
+//     so operations on different stripes don't touch the same lock at all.
+// StripedMap<K, V, 1, std::mutex> is the plain single mutex cache, which makes it easy
+// to compare.
+//
+// Each stripe sits on its own cache lines so neighboring locks don't false share.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "lock_types.hpp"
+
+template<typename KeyT, typename ValueT, size_t Stripes = 16, typename LockT = std::shared_mutex, typename HashT = std::hash<KeyT>>
+class StripedMap
+{
+public:
+    static_assert( Stripes > 0 && ( Stripes & ( Stripes - 1 ) ) == 0, "Stripes must be a power of 2" );
+
+    // Copy the value for key into value.  Returns false if the key isn't there.
+    bool Find( const KeyT& key, ValueT& value )
+    {
+        Stripe& stripe = StripeFor( key );
+        ReadLock<LockT> haveLock( stripe.lock );
+        const auto found = stripe.map.find( key );
+        if( found == stripe.map.end() )
+        {
+            return false;
+        }
+        value = found->second;
+        return true;
+    }
+
+    // Insert or overwrite.
+    void Insert( const KeyT& key, const ValueT& value )
+    {
+        Stripe& stripe = StripeFor( key );
+        std::unique_lock<LockT> haveLock( stripe.lock );
+        stripe.map[ key ] = value;
+    }
+
+    bool Erase( const KeyT& key )
+    {
+        Stripe& stripe = StripeFor( key );
+        std::unique_lock<LockT> haveLock( stripe.lock );
+        return stripe.map.erase( key ) != 0;
+    }
+
+    // Not a snapshot: stripes are counted one after another.
+    size_t Size()
+    {
+        size_t size = 0;
+        for( Stripe& stripe : m_Stripes )
+        {
+            ReadLock<LockT> haveLock( stripe.lock );
+            size += stripe.map.size();
+        }
+        return size;
+    }
+
+private:
+    struct alignas( 64 ) Stripe
+    {
+        LockT                                      lock;
+        std::unordered_map<KeyT, ValueT, HashT>    map;
+    };
+
+    Stripe& StripeFor( const KeyT& key )
+    {
+        // std::hash of an integer is often the integer itself, so mix before taking
+        // bits, or sequential keys would pile into a few stripes.
+        const uint64_t hash = static_cast<uint64_t>( HashT{}( key ) ) * 0x9E3779B97F4A7C15ull;
+        return m_Stripes[ ( hash >> 32 ) & ( Stripes - 1 ) ];
+    }
+
+    Stripe m_Stripes[ Stripes ];
+};